@@ -4,305 +4,1963 @@
 #include <array>
 #include <vector>
 #include <random>
+#include <optional>
 #include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <string>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* the sampling profiler and the perf counters are linux only, elsewhere their options are refused */
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#endif
+
+#include "b93.hh"
 
 namespace
 {
-    constexpr std::size_t max_row_size = 25;
-    constexpr std::size_t max_col_size = 80;
+    constexpr std::size_t max_row_size = b93::max_row_size;
+    constexpr std::size_t max_col_size = b93::max_col_size;
+    constexpr std::size_t grid_cells = b93::grid_cells;
     
     struct grid_t 
     { 
-        std::array<char, max_row_size * (max_col_size + 1)> data; 
+        std::array<char, grid_cells> data; 
         std::size_t rows = max_row_size; 
         std::size_t cols = max_col_size + 1; 
     };
     
-    grid_t readfile(std::string_view filepath)
+    /* lays a program out on the grid like b93.hh does, dropping what falls outside 80x25 */
+    grid_t parse_grid(char const *bytes, std::size_t size)
     {
         grid_t result = {};
-        std::ifstream file {filepath.data()};
+        result.data = b93::load({bytes, size});
+        return result;
+    }
 
-        /* open a file for reading */
-        if(file.good()) 
+    /* raw reads until the end of the file, since lines may run past 80 columns or end in \r\n and
+     * parse_grid() drops what falls outside the grid */
+    grid_t readfile(std::string_view filepath)
+    {
+        int const fd = open(std::string{filepath}.c_str(), O_RDONLY);
+        if (fd < 0)
         {
-            /* read the file into a buffer */
-            std::array<char, max_row_size * max_col_size> data = {};
-            file.read(data.data(), data.size());         
-
-            /* process the data read */
-            {
-                std::size_t bytes_read = file.gcount();
-
-                /* copy the buffer to the result */
-                for(std::size_t i = 0, j = 0, cols = 0; i < bytes_read; ++i, ++j)
-                {
-                    /* skip charecters that are not a unicode code point */
-                    if((reinterpret_cast<unsigned char*>(data.data())[i] & 0xC0u) == 0x80u) 
-                    {
-                        --j;
-                        continue;
-                    }
-    
-                    /* for every newline increase the row count */
-                    if(data[i] == '\n')
-                    {
-                        j += result.cols - cols - 1;
-                        cols = 0;
-                        continue;
-                    }
-    
-                    ++cols;
-                    result.data[j] = data[i];
-                }
-
-                return result;
-            }
+            std::fprintf(stderr, "Error: could not open %.*s", static_cast<int>(filepath.size()), filepath.data());
+            std::exit(EXIT_FAILURE);
         }
-        else
+
+        /* read the file into a buffer that fits 25 full crlf lines, growing it for anything longer */
+        std::string data(max_row_size * (max_col_size + 2), '\0');
+        std::size_t bytes_read = 0;
+        for (ssize_t got; (got = read(fd, data.data() + bytes_read, data.size() - bytes_read)) > 0;)
         {
-            std::fprintf(stderr, "Error: could not open %s", filepath.data());
-            std::exit(EXIT_FAILURE);
+            bytes_read += static_cast<std::size_t>(got);
+            if (bytes_read == data.size()) data.resize(data.size() * 2);
         }
+        close(fd);
+
+        return parse_grid(data.data(), bytes_read);
     }
-}
 
-void interpret(std::string_view filepath, bool extensions)
-{
-    auto[data, rows, cols] = readfile(filepath);
+    enum : unsigned
+    {
+        hook_count = 1u << 0,
+        hook_stats = 1u << 1,
+        hook_probe = 1u << 2,
+        hook_telemetry = 1u << 3,
+        hook_flight = 1u << 4,
+        hook_all = (1u << 5) - 1,
 
-    /* create a stack */
-    std::vector<std::int32_t> stack;
-    auto push = [&](std::int32_t value) -> void { stack.push_back(value); };
-    auto pop = [&]() -> std::int32_t
+        /* stops at the breakpoints, watchpoints and steps of options.debugger, only the decoded engine has it */
+        hook_debug = 1u << 5,
+    };
+
+    /* hook_stats and hook_telemetry build on the counters of hook_count */
+    constexpr bool valid_hooks(unsigned hooks)
     {
-        if (stack.empty())
-        {
-            return 0;
-        } 
-        else
+        return (hooks & (hook_stats | hook_telemetry)) == 0 || (hooks & hook_count) != 0;
+    }
+
+    /* counters collected by interpret<hook_stats>, other instantiations never touch them */
+    struct stats_t
+    {
+        std::uint64_t instructions = 0;
+        std::array<std::uint64_t, 256> opcodes = {};
+        std::size_t stack_high_water = 0;
+        std::uint64_t empty_pops = 0;
+        std::uint64_t gets = 0;
+        std::uint64_t gets_out_of_bounds = 0;
+        std::uint64_t puts = 0;
+        std::uint64_t puts_out_of_bounds = 0;
+        std::uint64_t random_draws = 0;
+        std::uint64_t bytes_in = 0;
+        std::uint64_t bytes_out = 0;
+
+        /* bytes the stack had allocated when the run ended, its peak since stacks never shrink. set by hook_count */
+        std::size_t stack_bytes = 0;
+
+        /* parallel to grid_t::data once track_cells() sized them, which only hook_stats needs:
+         * executions per cell and direction, and in bounds p writes per cell */
+        std::vector<std::array<std::uint64_t, 4>> heat;
+        std::vector<std::uint64_t> writes;
+
+        /* in bounds g reads per cell, and executions of cells that p had written before */
+        std::vector<std::uint64_t> reads;
+        std::vector<std::uint64_t> executions_after_write;
+
+        /* writes per p instruction and target, keyed by the site cell << 16 | the target cell */
+        std::unordered_map<std::uint32_t, std::uint64_t> put_sites;
+
+        void track_cells()
         {
-            std::int32_t temp = stack.back();
-            stack.pop_back();
-            return temp;
+            heat.assign(grid_cells, {});
+            writes.assign(grid_cells, 0);
+            reads.assign(grid_cells, 0);
+            executions_after_write.assign(grid_cells, 0);
         }
     };
 
-    /* hold the position of the cursor and the direction of it */
-    std::array<std::ptrdiff_t, 2> pos = {}, dir = {1, 0};
-    auto move = [&, cols = cols, rows = rows]() -> void
+    /* index of a direction in the order interpret() lists them: south, north, west, east */
+    constexpr std::size_t dir_index(std::array<std::ptrdiff_t, 2> const &dir)
+    {
+        return dir[1] > 0 ? 0 : dir[1] < 0 ? 1 : dir[0] < 0 ? 2 : 3;
+    }
+
+    class debugger_t;
+
+    /* the stack and playfield an engine ended with */
+    struct final_state_t
     {
-        pos[0] = ((pos[0] + dir[0]) % cols + cols) % cols;
-        pos[1] = ((pos[1] + dir[1]) % rows + rows) % rows;
+        std::vector<std::int32_t> stack;
+        std::array<char, grid_cells> data;
     };
 
-    /* the directions: south, north, east, west */
-    constexpr std::array<std::array<std::ptrdiff_t, 2>, 4> dirs {{{0, 1}, {0, -1}, {-1, 0}, {1, 0}}};
+    /* the engines share the semantics of / % and p with b93.hh. division by zero gives 0 where the spec
+     * would ask the user, and INT32_MIN / -1 wraps instead of trapping */
+    using b93::divide;
+    using b93::modulo;
+    using b93::truncate;
 
-    /* setup an prng */
-    std::mt19937 engine{std::random_device{}()};
-    std::uniform_int_distribution <std::int32_t> dist{0, 3};
+    /* runs a callable when the scope ends, whatever way it ends */
+    template <typename F>
+    struct on_exit_t
+    {
+        F callable;
+        ~on_exit_t() { callable(); }
+    };
 
-    for (;;)
+    template <typename F>
+    on_exit_t(F) -> on_exit_t<F>;
+
+    struct options_t
     {
-        /* see https://catseye.tc/view/Befunge-93/doc/Befunge-93.markdown for what every instruction means */
-        switch (char ins = data[pos[1] * cols + pos[0]])
+        bool extensions = false;
+        bool stats = false;
+        std::string_view heatmap;
+        long sample_hz = 0;
+        bool perf_counters = false;
+        std::string_view telemetry_shm;
+        std::uint64_t max_steps = UINT64_MAX;
+        std::size_t flight_recorder = 0;
+        std::string_view record;
+        std::string_view replay;
+        bool smc_report = false;
+        std::size_t engine = 0;
+        bool compare_engines = false;
+        std::size_t repeat = 0;
+        std::string_view sink = "/dev/null";
+
+        /* ? draws from a prng seeded with seed instead of the random device */
+        bool seeded = false;
+        std::uint32_t seed = 0;
+
+        /* where the engines leave their final stack and playfield, for the differential fuzzer */
+        final_state_t *final_state = nullptr;
+        std::string_view smc_hints;
+
+        /* dot or json, empty when the program runs instead */
+        std::string_view dump_cfg;
+        bool cfg_profile = false;
+        bool disasm = false;
+
+        /* - or a unix socket path for the --debug line protocol, and the debugger of that run */
+        std::string_view debug;
+        debugger_t *debugger = nullptr;
+        std::uint64_t checkpoint_interval = 1 << 16;
+    };
+
+    /* the prng behind ?, seeded on the first draw so programs without ? never touch the random device.
+     * the seed is kept, so going back to a state from before the first draw draws the same again */
+    class lazy_prng_t
+    {
+    public:
+        explicit lazy_prng_t(options_t const &options) : options{options} {}
+
+        std::size_t draw()
         {
-            case '+':
-            {
-                push(pop() + pop());
-            } break;
+            if (!seed) seed = options.seeded ? options.seed : std::random_device{}();
+            if (!engine) engine.emplace(*seed);
+            return static_cast<std::size_t>(dist(*engine));
+        }
 
-            case '-':
-            {
-                std::int32_t const a = pop();
-                std::int32_t const b = pop();
-                push(b - a);
-            } break;
+        std::optional<std::mt19937> const &state() const { return engine; }
 
-            case '/':
-            {
-                std::int32_t const a = pop();
-                std::int32_t const b = pop();
-                push(b / a);
-            } break;
+        void restore(std::mt19937 const *state)
+        {
+            if (state != nullptr) engine = *state;
+            else engine.reset();
+        }
 
-            case '*':
-            {
-                push(pop() * pop());
-            } break;
+    private:
+        options_t const &options;
+        std::optional<std::uint32_t> seed;
+        std::optional<std::mt19937> engine;
+        std::uniform_int_distribution<std::int32_t> dist {0, 3};
+    };
 
-            case '%':
-            {
-                std::int32_t const a = pop();
-                std::int32_t const b = pop();
-                push(b % a);
-            } break;
+    /* what string mode pushes from a (cell, direction), walked the first time it runs and kept until a
+     * p changes a cell of the same row (east and west) or column (north and south). a literal is at
+     * most one lap of its line, since the walk comes back to the opening quote */
+    class string_literals_t
+    {
+    public:
+        struct literal_t
+        {
+            std::int32_t const *chars;
+            std::size_t size;
+            std::size_t exit;
+        };
 
-            case '!':
-            {
-                if (stack.empty())
-                {
-                    /* 0 == 0 is true */
-                    push(1);
-                } 
-                else
-                {
-                    stack.back() = stack.back() == 0;
-                }
-            } break;
+        literal_t get(grid_t const &grid, std::size_t cell, std::array<std::ptrdiff_t, 2> const &dir)
+        {
+            if (!entries) entries = std::make_unique<std::array<entry_t, 4>[]>(grid_cells);
 
-            case '`':
+            std::size_t const x = cell % grid.cols, y = cell / grid.cols;
+            bool const horizontal = dir[1] == 0;
+            std::uint32_t const generation = horizontal ? row_generations[y] : col_generations[x];
+            entry_t &entry = entries[cell][dir_index(dir)];
+            if (entry.generation != generation)
             {
-                std::int32_t a = pop();
-                std::int32_t b = pop();
-                push(b > a);
-            } break;
+                walk(grid, x, y, dir, horizontal, entry);
+                entry.generation = generation;
+            }
 
-            case '^':
-            {
-                dir = dirs[1];
-            } break;
+            return {chars.data() + entry.offset, entry.size, entry.exit};
+        }
 
-            case 'v':
-            {
-                dir = dirs[0];
-            } break;
+        /* a p wrote a different value to (x, y) */
+        void invalidate(std::size_t x, std::size_t y)
+        {
+            ++row_generations[y];
+            ++col_generations[x];
+        }
 
-            case '>':
-            {
-                dir = dirs[3];
-            } break;
+    private:
+        /* generation 0 is never current, so a fresh entry is walked on first use */
+        struct entry_t
+        {
+            std::uint32_t offset;
+            std::uint32_t generation;
+            std::uint16_t size;
+            std::uint16_t exit;
+        };
 
-            case '<':
+        /* an entry keeps the slot of chars it got the first time, sized for the longest literal of
+         * its line, so walking it again after a p does not grow chars */
+        void walk(grid_t const &grid, std::size_t x, std::size_t y, std::array<std::ptrdiff_t, 2> const &dir, bool horizontal, entry_t &entry)
+        {
+            if (entry.generation == 0)
             {
-                dir = dirs[2];
-            } break;
+                entry.offset = static_cast<std::uint32_t>(chars.size());
+                chars.resize(chars.size() + (horizontal ? grid.cols : grid.rows) - 1);
+            }
 
-            case '_':
+            std::size_t size = 0;
+            for (;;)
             {
-                dir = pop() != 0 ? dirs[2] : dirs[3];
-            } break;
+                x = (x + grid.cols + dir[0]) % grid.cols;
+                y = (y + grid.rows + dir[1]) % grid.rows;
+                char const ch = grid.data[y * grid.cols + x];
+                if (ch == '"') break;
 
-            case '|':
-            {
-                dir = pop() != 0 ? dirs[1] : dirs[0];
-            } break;
+                chars[entry.offset + size++] = ch;
+            }
 
-            case '"':
-            {
-                move();
+            entry.size = static_cast<std::uint16_t>(size);
+            entry.exit = static_cast<std::uint16_t>(y * grid.cols + x);
+        }
 
-                /* while the current ch is not a quote push its ascii value */
-                for (;;)
-                {
-                    if (char const ch = data[pos[1] * cols + pos[0]]; ch != '"')
-                    {
-                        push(ch);
-                        move();
-                    } 
-                    else
-                    {
-                        break;
-                    }
-                }
-            } break;
+        std::unique_ptr<std::array<entry_t, 4>[]> entries;
+        std::vector<std::int32_t> chars;
+        std::array<std::uint32_t, max_row_size> row_generations = filled<max_row_size>(1);
+        std::array<std::uint32_t, max_col_size + 1> col_generations = filled<max_col_size + 1>(1);
 
-            case ':':
-            {
-                push(stack.empty() ? 0 : stack.back());
-            } break;
+        template <std::size_t N>
+        static std::array<std::uint32_t, N> filled(std::uint32_t value)
+        {
+            std::array<std::uint32_t, N> result;
+            result.fill(value);
+            return result;
+        }
+    };
 
-            case '\\':
-            {
-                /* NOTE: this is needed because the \ op
-                 * is the same as:
-                 * a = pop()
-                 * b = pop()
-                 * push(a)
-                 * push(b)
-                 */
-                switch (stack.size())
-                {
-                    default:
-                    {
-                        std::swap(stack.end()[-1], stack.end()[-2]);
-                    } break;
+    /* write a json string for an opcode, escaping anything that is not printable ascii */
+    void print_json_opcode(std::FILE *out, unsigned char ch)
+    {
+        if (ch == '"' || ch == '\\')
+        {
+            std::fprintf(out, "\"\\%c\"", ch);
+        }
+        else if (ch < 0x20 || ch >= 0x7f)
+        {
+            std::fprintf(out, "\"\\u%04x\"", ch);
+        }
+        else
+        {
+            std::fprintf(out, "\"%c\"", ch);
+        }
+    }
 
-                    case 0: break;
+    void print_stats_json(std::FILE *out, stats_t const &stats, double wall_seconds, double cpu_seconds)
+    {
+        rusage usage = {};
+        getrusage(RUSAGE_SELF, &usage);
 
-                    case 1:
-                    {
-                        push(0);
-                    } break;
-                }
-            } break;
+        std::fprintf(out, "{\n");
+        std::fprintf(out, "  \"instructions\": %" PRIu64 ",\n", stats.instructions);
+        std::fprintf(out, "  \"instructions_per_second\": %.0f,\n",
+                     wall_seconds > 0 ? static_cast<double>(stats.instructions) / wall_seconds : 0.0);
 
-            case '$':
-            {
-                pop();
-            } break;
+        /* only opcodes that were actually executed */
+        std::fprintf(out, "  \"opcodes\": {");
+        bool first = true;
+        for (std::size_t i = 0; i < stats.opcodes.size(); ++i)
+        {
+            if (stats.opcodes[i] == 0) continue;
 
-            case '.':
-            {
-                std::int32_t value = pop();
-                std::printf("%" PRId32 " ", value);
-            } break;
+            std::fprintf(out, first ? "\n    " : ",\n    ");
+            print_json_opcode(out, static_cast<unsigned char>(i));
+            std::fprintf(out, ": %" PRIu64, stats.opcodes[i]);
+            first = false;
+        }
+        std::fprintf(out, first ? "},\n" : "\n  },\n");
 
-            case ',':
-            {
-                char value = static_cast<char>(pop());
-                std::printf("%c", value);
-            } break;
+        std::fprintf(out, "  \"stack_high_water\": %zu,\n", stats.stack_high_water);
+        std::fprintf(out, "  \"empty_pops\": %" PRIu64 ",\n", stats.empty_pops);
+        std::fprintf(out, "  \"get\": {\"total\": %" PRIu64 ", \"out_of_bounds\": %" PRIu64 "},\n",
+                     stats.gets, stats.gets_out_of_bounds);
+        std::fprintf(out, "  \"put\": {\"total\": %" PRIu64 ", \"out_of_bounds\": %" PRIu64 "},\n",
+                     stats.puts, stats.puts_out_of_bounds);
+        std::fprintf(out, "  \"random_draws\": %" PRIu64 ",\n", stats.random_draws);
+        std::fprintf(out, "  \"bytes_in\": %" PRIu64 ",\n", stats.bytes_in);
+        std::fprintf(out, "  \"bytes_out\": %" PRIu64 ",\n", stats.bytes_out);
+        std::fprintf(out, "  \"wall_seconds\": %.6f,\n", wall_seconds);
+        std::fprintf(out, "  \"cpu_seconds\": %.6f,\n", cpu_seconds);
 
-            case '#':
-            {
-                move();
-            } break;
+        /* ru_maxrss is in kilobytes on linux */
+        std::fprintf(out, "  \"peak_rss_kb\": %ld\n", usage.ru_maxrss);
+        std::fprintf(out, "}\n");
+    }
 
-            case 'g':
-            {
+    std::FILE *open_output(std::string const &path)
+    {
+        std::FILE *file = std::fopen(path.c_str(), "wb");
+        if (!file)
+        {
+            std::fprintf(stderr, "Error: could not open %s\n", path.c_str());
+            std::exit(EXIT_FAILURE);
+        }
 
-                std::ptrdiff_t y = static_cast<std::ptrdiff_t>(pop());
-                std::ptrdiff_t x = static_cast<std::ptrdiff_t>(pop());
+        return file;
+    }
 
-                push(x >= 0 && x < static_cast<std::ptrdiff_t>(max_col_size) &&
-                     y >= 0 && y < static_cast<std::ptrdiff_t>(max_row_size)
-                     ? data[y * cols + x] : 0);
-            } break;
+    /* writes <path>.csv and <path>.ppm and prints a coverage summary to stderr */
+    void write_heatmap(std::string_view path, grid_t const &source, stats_t const &stats)
+    {
+        std::string const base{path};
+        std::uint64_t hottest = 0;
 
-            case 'p':
+        /* one row per cell: the source charecter, executions per direction and p writes */
+        {
+            std::FILE *csv = open_output(base + ".csv");
+            std::fprintf(csv, "x,y,char,south,north,west,east,total,writes\n");
+            for (std::size_t y = 0; y < max_row_size; ++y)
             {
-                std::ptrdiff_t y = (static_cast<std::ptrdiff_t>(pop()));
-                std::ptrdiff_t x = (static_cast<std::ptrdiff_t>(pop()));
-                std::int32_t value = pop();
-
-                /* check for out of bounds */
-                if(x >= 0 && x < static_cast<std::ptrdiff_t>(max_col_size) &&
-                   y >= 0 && y < static_cast<std::ptrdiff_t>(max_row_size))
+                for (std::size_t x = 0; x < max_col_size; ++x)
                 {
-                    data[y * cols + x] = value;
+                    std::size_t const cell = y * source.cols + x;
+                    auto const &heat = stats.heat[cell];
+                    std::uint64_t const total = heat[0] + heat[1] + heat[2] + heat[3];
+                    hottest = std::max(hottest, total);
+
+                    std::fprintf(csv, "%zu,%zu,%d,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+                                 x, y, static_cast<unsigned char>(source.data[cell]),
+                                 heat[0], heat[1], heat[2], heat[3], total, stats.writes[cell]);
                 }
-            } break;
+            }
+            std::fclose(csv);
+        }
 
-            case '&':
-            {
-                std::int32_t value;
-                std::scanf("%" SCNi32, &value);
-                push(value);
-            } break;
+        /* an 8x8 block per cell: red is log scaled heat, cells holding code in the source are tinted blue */
+        {
+            constexpr std::size_t scale = 8;
+            std::FILE *ppm = open_output(base + ".ppm");
+            std::fprintf(ppm, "P6\n%zu %zu\n255\n", max_col_size * scale, max_row_size * scale);
 
-            case '~':
+            double const log_hottest = std::log1p(static_cast<double>(hottest));
+            for (std::size_t py = 0; py < max_row_size * scale; ++py)
             {
-                char value;
-                std::scanf("%c", &value);
-                push(value);
-            } break;
+                for (std::size_t px = 0; px < max_col_size * scale; ++px)
+                {
+                    std::size_t const cell = py / scale * source.cols + px / scale;
+                    auto const &heat = stats.heat[cell];
+                    std::uint64_t const total = heat[0] + heat[1] + heat[2] + heat[3];
+                    char const ch = source.data[cell];
+                    bool const code = ch != ' ' && ch != '\0';
+                    bool const border = px % scale == 0 || py % scale == 0;
 
-            /* exit the program */
-            case '@': return;
+                    unsigned char const red = log_hottest > 0
+                        ? static_cast<unsigned char>(255.0 * std::log1p(static_cast<double>(total)) / log_hottest)
+                        : 0;
+                    unsigned char const rgb[3] = {red, static_cast<unsigned char>(border ? 32 : 0),
+                                                  static_cast<unsigned char>(code ? 96 : border ? 32 : 0)};
+                    std::fwrite(rgb, 1, sizeof(rgb), ppm);
+                }
+            }
+            std::fclose(ppm);
+        }
 
-            /* for a number push its numeric value onto the stack */
+        /* string mode pushes the cells up to the closing quote without executing them, so walk every
+         * opening quote from each direction it ran in to tell those cells apart from dead code */
+        std::vector<bool> in_string(grid_cells);
+        constexpr std::array<std::array<std::ptrdiff_t, 2>, 4> dirs {{{0, 1}, {0, -1}, {-1, 0}, {1, 0}}};
+        for (std::size_t cell = 0; cell < grid_cells; ++cell)
+        {
+            if (source.data[cell] != '"') continue;
+            for (std::size_t d = 0; d < dirs.size(); ++d)
+            {
+                if (stats.heat[cell][d] == 0) continue;
+                std::size_t x = cell % source.cols, y = cell / source.cols;
+                for (std::size_t step = 0; step < grid_cells; ++step)
+                {
+                    x = (x + source.cols + dirs[d][0]) % source.cols;
+                    y = (y + source.rows + dirs[d][1]) % source.rows;
+                    in_string[y * source.cols + x] = true;
+                    if (source.data[y * source.cols + x] == '"') break;
+                }
+            }
+        }
+
+        /* coverage summary */
+        std::size_t code_cells = 0, never_executed = 0, string_only = 0, executed_and_written = 0;
+        for (std::size_t y = 0; y < max_row_size; ++y)
+        {
+            for (std::size_t x = 0; x < max_col_size; ++x)
+            {
+                std::size_t const cell = y * source.cols + x;
+                auto const &heat = stats.heat[cell];
+                bool const executed = heat[0] + heat[1] + heat[2] + heat[3] != 0;
+                char const ch = source.data[cell];
+
+                if (ch != ' ' && ch != '\0')
+                {
+                    ++code_cells;
+                    string_only += !executed && in_string[cell];
+                    never_executed += !executed && !in_string[cell];
+                }
+
+                executed_and_written += executed && stats.writes[cell] != 0;
+            }
+        }
+
+        std::fprintf(stderr, "heatmap: %zu of %zu non-blank cells never executed, %zu only pushed by string mode, %zu cells executed and written by p\n",
+                     never_executed, code_cells, string_only, executed_and_written);
+        for (std::size_t y = 0; y < max_row_size; ++y)
+        {
+            for (std::size_t x = 0; x < max_col_size; ++x)
+            {
+                std::size_t const cell = y * source.cols + x;
+                auto const &heat = stats.heat[cell];
+                if (heat[0] + heat[1] + heat[2] + heat[3] != 0 && stats.writes[cell] != 0)
+                {
+                    std::fprintf(stderr, "  (%zu, %zu) written %" PRIu64 " times\n", x, y, stats.writes[cell]);
+                }
+            }
+        }
+    }
+
+    /* how a cell was used during a run, from the counters of interpret<hook_stats> */
+    enum class cell_class_t { unused, code, data, self_modifying };
+
+    cell_class_t classify_cell(stats_t const &stats, std::size_t cell)
+    {
+        auto const &heat = stats.heat[cell];
+        bool const executed = heat[0] + heat[1] + heat[2] + heat[3] != 0;
+
+        if (stats.executions_after_write[cell] != 0) return cell_class_t::self_modifying;
+        if (executed) return cell_class_t::code;
+        if (stats.writes[cell] != 0 || stats.reads[cell] != 0) return cell_class_t::data;
+        return cell_class_t::unused;
+    }
+
+    constexpr std::array<char, 4> cell_class_letters {'.', 'c', 'd', 's'};
+
+    /* cell classes, write counts and for every p instruction the code it overwrote */
+    void print_smc_report(std::FILE *out, grid_t const &grid, stats_t const &stats)
+    {
+        std::array<std::size_t, 4> counts = {};
+        std::uint64_t code_writes = 0;
+        for (std::size_t y = 0; y < max_row_size; ++y)
+        {
+            for (std::size_t x = 0; x < max_col_size; ++x)
+            {
+                std::size_t const cell = y * grid.cols + x;
+                cell_class_t const kind = classify_cell(stats, cell);
+                ++counts[static_cast<std::size_t>(kind)];
+                if (kind == cell_class_t::code || kind == cell_class_t::self_modifying) code_writes += stats.writes[cell];
+            }
+        }
+
+        std::fprintf(out, "smc report: %zu code, %zu data, %zu self-modifying, %zu unused cells, %" PRIu64 " of %" PRIu64 " p writes hit code\n",
+                     counts[1], counts[2], counts[3], counts[0], code_writes, stats.puts - stats.puts_out_of_bounds);
+
+        /* the playfield as class letters */
+        for (std::size_t y = 0; y < max_row_size; ++y)
+        {
+            std::fprintf(out, "  ");
+            for (std::size_t x = 0; x < max_col_size; ++x)
+            {
+                std::fputc(cell_class_letters[static_cast<std::size_t>(classify_cell(stats, y * grid.cols + x))], out);
+            }
+            std::fputc('\n', out);
+        }
+
+        /* most written cells */
+        std::vector<std::pair<std::uint64_t, std::size_t>> written;
+        for (std::size_t cell = 0; cell < grid_cells; ++cell)
+        {
+            if (stats.writes[cell] != 0) written.emplace_back(stats.writes[cell], cell);
+        }
+        std::sort(written.begin(), written.end(), std::greater<>{});
+
+        std::fprintf(out, "most written cells:\n");
+        for (std::size_t i = 0; i < written.size() && i < 10; ++i)
+        {
+            std::size_t const cell = written[i].second;
+            std::fprintf(out, "  (%zu, %zu) %c %" PRIu64 " writes, executed %" PRIu64 " times after a write\n",
+                         cell % grid.cols, cell / grid.cols, cell_class_letters[static_cast<std::size_t>(classify_cell(stats, cell))],
+                         written[i].first, stats.executions_after_write[cell]);
+        }
+
+        /* group the code cells each p site wrote into runs along a row */
+        std::vector<std::pair<std::size_t, std::size_t>> sites;
+        for (auto const &[key, count] : stats.put_sites)
+        {
+            cell_class_t const kind = classify_cell(stats, key & 0xffff);
+            if (kind == cell_class_t::code || kind == cell_class_t::self_modifying) sites.emplace_back(key >> 16, key & 0xffff);
+        }
+        std::sort(sites.begin(), sites.end());
+
+        std::fprintf(out, "code invalidated by p:\n");
+        for (std::size_t i = 0; i < sites.size();)
+        {
+            std::size_t const site = sites[i].first;
+            std::fprintf(out, "  p at (%zu, %zu):", site % grid.cols, site / grid.cols);
+            for (; i < sites.size() && sites[i].first == site;)
+            {
+                std::size_t const start = sites[i].second;
+                std::size_t end = start;
+                for (++i; i < sites.size() && sites[i].first == site && sites[i].second == end + 1; ++i) ++end;
+
+                if (start == end) std::fprintf(out, " (%zu, %zu)", start % grid.cols, start / grid.cols);
+                else std::fprintf(out, " (%zu..%zu, %zu)", start % grid.cols, end % grid.cols, start / grid.cols);
+            }
+            std::fputc('\n', out);
+        }
+    }
+
+    /* the class letters as a 25 line by 80 column text file, for engines to read back on later runs */
+    void write_smc_hints(std::string_view path, grid_t const &grid, stats_t const &stats)
+    {
+        std::FILE *out = open_output(std::string{path});
+        std::fprintf(out, "b93-smc-hints 1\n");
+        for (std::size_t y = 0; y < max_row_size; ++y)
+        {
+            for (std::size_t x = 0; x < max_col_size; ++x)
+            {
+                std::fputc(cell_class_letters[static_cast<std::size_t>(classify_cell(stats, y * grid.cols + x))], out);
+            }
+            std::fputc('\n', out);
+        }
+        std::fclose(out);
+    }
+
+    /* the interpreter state a SIGPROF handler can see, published every dispatch by interpret<hook_probe> */
+    struct probe_t
+    {
+        /* x | y << 8 | direction << 16 | tier << 24 */
+        std::atomic<std::uint32_t> location {0};
+        std::atomic<std::uint32_t> stack_depth {0};
+    };
+
+    probe_t probe;
+
+    /* the execution engines, a probe reports the one that is running */
+    enum engine_t : std::size_t { engine_switch, engine_decoded, engine_compact };
+    constexpr std::array<char const *, 3> tier_names {"switch", "decoded", "compact"};
+    constexpr std::array<char const *, 4> dir_names {"south", "north", "west", "east"};
+
+    void publish_probe(std::array<std::ptrdiff_t, 2> const &pos, std::array<std::ptrdiff_t, 2> const &dir,
+                       std::size_t stack_depth, std::uint32_t tier)
+    {
+        probe.location.store(static_cast<std::uint32_t>(pos[0]) |
+                             static_cast<std::uint32_t>(pos[1]) << 8 |
+                             static_cast<std::uint32_t>(dir_index(dir)) << 16 |
+                             tier << 24, std::memory_order_relaxed);
+        probe.stack_depth.store(static_cast<std::uint32_t>(stack_depth), std::memory_order_relaxed);
+    }
+
+    /* single producer (the signal handler), single consumer (the drain thread), samples are dropped when full */
+    struct sample_ring_t
+    {
+        struct sample_t
+        {
+            std::uint32_t location;
+            std::uint32_t stack_depth;
+        };
+
+        static constexpr std::size_t capacity = 1 << 16;
+        std::array<sample_t, capacity> samples;
+        std::atomic<std::size_t> head {0};
+        std::atomic<std::size_t> tail {0};
+        std::atomic<std::uint64_t> dropped {0};
+    };
+
+    sample_ring_t sample_ring;
+
+    /* samples aggregated by location, and the total stack depth seen at each */
+    struct sample_profile_t
+    {
+        std::unordered_map<std::uint32_t, std::pair<std::uint64_t, std::uint64_t>> locations;
+        std::uint64_t total = 0;
+
+        void drain()
+        {
+            std::size_t tail = sample_ring.tail.load(std::memory_order_relaxed);
+            std::size_t const head = sample_ring.head.load(std::memory_order_acquire);
+            for (; tail != head; ++tail)
+            {
+                auto const &sample = sample_ring.samples[tail % sample_ring.capacity];
+                auto &[count, depth] = locations[sample.location];
+                ++count;
+                depth += sample.stack_depth;
+                ++total;
+            }
+            sample_ring.tail.store(tail, std::memory_order_release);
+        }
+    };
+
+#ifdef __linux__
+    void on_sigprof(int)
+    {
+        std::size_t const head = sample_ring.head.load(std::memory_order_relaxed);
+        if (head - sample_ring.tail.load(std::memory_order_acquire) == sample_ring.capacity)
+        {
+            sample_ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        std::atomic_signal_fence(std::memory_order_acquire);
+        sample_ring.samples[head % sample_ring.capacity] = {probe.location.load(std::memory_order_relaxed),
+                                                            probe.stack_depth.load(std::memory_order_relaxed)};
+        sample_ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    /* arms ITIMER_PROF for the lifetime of the object and drains the ring on a helper thread */
+    class sampler_t
+    {
+    public:
+        explicit sampler_t(long hz)
+        {
+            struct sigaction action = {};
+            action.sa_handler = on_sigprof;
+            action.sa_flags = SA_RESTART;
+            sigemptyset(&action.sa_mask);
+            sigaction(SIGPROF, &action, nullptr);
+
+            drainer = std::thread{[this]
+            {
+                while (!stopping.load(std::memory_order_relaxed))
+                {
+                    profile.drain();
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                }
+            }};
+
+            long const interval = std::max(1L, 1000000L / hz);
+            itimerval timer = {{interval / 1000000, interval % 1000000}, {interval / 1000000, interval % 1000000}};
+            setitimer(ITIMER_PROF, &timer, nullptr);
+        }
+
+        sampler_t(sampler_t const &) = delete;
+        sampler_t &operator=(sampler_t const &) = delete;
+
+        ~sampler_t()
+        {
+            stop();
+        }
+
+        /* disarms the timer and collects the last samples */
+        void stop()
+        {
+            if (!drainer.joinable()) return;
+
+            itimerval timer = {};
+            setitimer(ITIMER_PROF, &timer, nullptr);
+            signal(SIGPROF, SIG_DFL);
+
+            stopping.store(true, std::memory_order_relaxed);
+            drainer.join();
+            profile.drain();
+        }
+
+        sample_profile_t profile;
+
+    private:
+        std::atomic<bool> stopping {false};
+        std::thread drainer;
+    };
+#else
+    /* never made, --sample-profile is refused */
+    class sampler_t
+    {
+    public:
+        explicit sampler_t(long) {}
+        void stop() {}
+        sample_profile_t profile;
+    };
+#endif
+
+    /* a flamegraph frame name for a cell, avoiding the ';' and ' ' that folded stacks use as separators */
+    std::string cell_frame(grid_t const &grid, std::uint32_t x, std::uint32_t y)
+    {
+        unsigned char const ch = static_cast<unsigned char>(grid.data[y * grid.cols + x]);
+        char frame[32];
+        if (ch > ' ' && ch < 0x7f && ch != ';')
+        {
+            std::snprintf(frame, sizeof(frame), "(%u,%u)_'%c'", x, y, ch);
+        }
+        else
+        {
+            std::snprintf(frame, sizeof(frame), "(%u,%u)_#%u", x, y, ch);
+        }
+
+        return frame;
+    }
+
+    /* prints the hottest cells and paths to stderr and writes a folded stack file for flamegraph.pl */
+    void report_sample_profile(sample_profile_t const &profile, std::uint64_t dropped, grid_t const &grid)
+    {
+        std::fprintf(stderr, "sample profile: %" PRIu64 " samples, %" PRIu64 " dropped\n", profile.total, dropped);
+        if (profile.total == 0) return;
+
+        std::vector<std::pair<std::uint32_t, std::pair<std::uint64_t, std::uint64_t>>> cells(profile.locations.begin(),
+                                                                                           profile.locations.end());
+        std::sort(cells.begin(), cells.end(), [](auto const &a, auto const &b) { return a.second.first > b.second.first; });
+
+        std::fprintf(stderr, "hot cells:\n");
+        for (std::size_t i = 0; i < cells.size() && i < 20; ++i)
+        {
+            auto const &[location, value] = cells[i];
+            std::uint32_t const x = location & 0xff, y = location >> 8 & 0xff, dir = location >> 16 & 0xff;
+            std::fprintf(stderr, "  %6.2f%%  %-16s %-5s %-6s avg stack %.1f\n",
+                         100.0 * value.first / profile.total, cell_frame(grid, x, y).c_str(),
+                         dir_names[dir], tier_names[location >> 24],
+                         static_cast<double>(value.second) / value.first);
+        }
+
+        /* a path is the row or column a cell is traversed along, in its direction */
+        std::unordered_map<std::uint32_t, std::uint64_t> paths;
+        for (auto const &[location, value] : cells)
+        {
+            std::uint32_t const dir = location >> 16 & 0xff;
+            std::uint32_t const line = dir < 2 ? (location & 0xff) : (location >> 8 & 0xff);
+            paths[line | dir << 16] += value.first;
+        }
+
+        std::vector<std::pair<std::uint32_t, std::uint64_t>> hot_paths(paths.begin(), paths.end());
+        std::sort(hot_paths.begin(), hot_paths.end(), [](auto const &a, auto const &b) { return a.second > b.second; });
+
+        std::fprintf(stderr, "hot paths:\n");
+        for (std::size_t i = 0; i < hot_paths.size() && i < 10; ++i)
+        {
+            std::uint32_t const dir = hot_paths[i].first >> 16, line = hot_paths[i].first & 0xff;
+            std::fprintf(stderr, "  %6.2f%%  %s %u heading %s\n", 100.0 * hot_paths[i].second / profile.total,
+                         dir < 2 ? "column" : "row", line, dir_names[dir]);
+        }
+
+        /* tier;path;cell count */
+        std::string const folded_path = "b93-" + std::to_string(getpid()) + ".folded";
+        std::FILE *folded = open_output(folded_path);
+        for (auto const &[location, value] : cells)
+        {
+            std::uint32_t const x = location & 0xff, y = location >> 8 & 0xff, dir = location >> 16 & 0xff;
+            std::fprintf(folded, "%s;%s_%u_%s;%s %" PRIu64 "\n", tier_names[location >> 24],
+                         dir < 2 ? "column" : "row", dir < 2 ? x : y, dir_names[dir],
+                         cell_frame(grid, x, y).c_str(), value.first);
+        }
+        std::fclose(folded);
+        std::fprintf(stderr, "folded stacks written to %s\n", folded_path.c_str());
+    }
+
+#ifdef __linux__
+    /* a perf_event group around the phases of a run, members that the kernel refuses are left out */
+    class perf_group_t
+    {
+    public:
+        static constexpr std::size_t event_count = 4;
+        static constexpr std::array<char const *, event_count> event_names {"cycles", "instructions", "branch-misses", "L1d-misses"};
+
+        /* scaled counts, negative when an event is unavailable */
+        using counts_t = std::array<double, event_count>;
+
+        explicit perf_group_t(bool enabled)
+        {
+            if (!enabled) return;
+
+            constexpr std::array<std::pair<std::uint32_t, std::uint64_t>, event_count> events {{
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+                {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                                     PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+            }};
+
+            int error = 0;
+            for (std::size_t i = 0; i < event_count; ++i)
+            {
+                perf_event_attr attr = {};
+                attr.size = sizeof(attr);
+                attr.type = events[i].first;
+                attr.config = events[i].second;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+                int const fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+                if (fd < 0)
+                {
+                    error = errno;
+                    continue;
+                }
+
+                if (leader < 0) leader = fd;
+                fds[i] = fd;
+                slots[i] = members++;
+            }
+
+            if (leader < 0)
+            {
+                std::fprintf(stderr, "perf counters unavailable: %s\n", std::strerror(error));
+                return;
+            }
+
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            last = read();
+        }
+
+        perf_group_t(perf_group_t const &) = delete;
+        perf_group_t &operator=(perf_group_t const &) = delete;
+
+        ~perf_group_t()
+        {
+            for (int fd : fds)
+            {
+                if (fd >= 0) close(fd);
+            }
+        }
+
+        /* attributes everything counted since the previous phase to name */
+        void phase(char const *name)
+        {
+            if (leader < 0) return;
+
+            counts_t const now = read();
+            counts_t delta;
+            for (std::size_t i = 0; i < event_count; ++i)
+            {
+                delta[i] = now[i] < 0 ? -1 : now[i] - last[i];
+            }
+
+            phases.emplace_back(name, delta);
+            last = now;
+        }
+
+        /* per phase counts, then ipc and per befunge instruction figures for the execution phase */
+        void report(std::FILE *out, char const *execution_phase, std::uint64_t befunge_instructions) const
+        {
+            if (leader < 0) return;
+
+            std::fprintf(out, "perf counters:\n  %-14s", "phase");
+            for (char const *name : event_names) std::fprintf(out, " %15s", name);
+            std::fprintf(out, " %7s\n", "ipc");
+
+            for (auto const &[name, counts] : phases)
+            {
+                std::fprintf(out, "  %-14s", name);
+                for (double count : counts)
+                {
+                    if (count < 0) std::fprintf(out, " %15s", "n/a");
+                    else std::fprintf(out, " %15.0f", count);
+                }
+
+                if (counts[0] > 0 && counts[1] >= 0) std::fprintf(out, " %7.2f\n", counts[1] / counts[0]);
+                else std::fprintf(out, " %7s\n", "n/a");
+
+                if (std::string_view{name} != execution_phase || befunge_instructions == 0) continue;
+
+                std::fprintf(out, "  %-14s", "  per b93 ins");
+                for (double count : counts)
+                {
+                    if (count < 0) std::fprintf(out, " %15s", "n/a");
+                    else std::fprintf(out, " %15.3f", count / static_cast<double>(befunge_instructions));
+                }
+                std::fprintf(out, "\n");
+            }
+        }
+
+    private:
+        counts_t read() const
+        {
+            /* nr, time_enabled, time_running, then one value per member */
+            std::array<std::uint64_t, 3 + event_count> buffer = {};
+            counts_t result;
+            result.fill(-1);
+            if (::read(leader, buffer.data(), sizeof(buffer)) <= 0) return result;
+
+            /* scale for multiplexing */
+            double const scale = buffer[2] > 0 ? static_cast<double>(buffer[1]) / static_cast<double>(buffer[2]) : 1.0;
+            for (std::size_t i = 0; i < event_count; ++i)
+            {
+                if (fds[i] >= 0) result[i] = static_cast<double>(buffer[3 + slots[i]]) * scale;
+            }
+
+            return result;
+        }
+
+        int leader = -1;
+        std::array<int, event_count> fds {-1, -1, -1, -1};
+        std::array<std::size_t, event_count> slots = {};
+        std::size_t members = 0;
+        counts_t last = {};
+        std::vector<std::pair<char const *, counts_t>> phases;
+    };
+#else
+    /* counts nothing, --perf-counters is refused */
+    class perf_group_t
+    {
+    public:
+        explicit perf_group_t(bool) {}
+        void phase(char const *) {}
+        void report(std::FILE *, char const *, std::uint64_t) const {}
+    };
+#endif
+
+    /* chrome trace format spans, buffered per thread so tracing never serializes the workers */
+    struct trace_event_t
+    {
+        char const *name;
+        char const *category;
+        std::int64_t start_us;
+        std::int64_t duration_us;
+        std::string detail;
+    };
+
+    struct trace_buffer_t
+    {
+        long tid;
+        std::vector<trace_event_t> events;
+    };
+
+    std::atomic<bool> tracing {false};
+    auto const trace_epoch = std::chrono::steady_clock::now();
+    std::mutex trace_buffers_mutex;
+    std::vector<std::unique_ptr<trace_buffer_t>> trace_buffers;
+
+    std::int64_t trace_now()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - trace_epoch).count();
+    }
+
+    /* the calling thread's buffer, registered under the lock only the first time */
+    trace_buffer_t &local_trace_buffer()
+    {
+        thread_local trace_buffer_t *buffer = nullptr;
+        if (!buffer)
+        {
+            std::lock_guard<std::mutex> lock{trace_buffers_mutex};
+            trace_buffers.push_back(std::make_unique<trace_buffer_t>());
+            buffer = trace_buffers.back().get();
+#ifdef __linux__
+            buffer->tid = static_cast<long>(syscall(SYS_gettid));
+#else
+            buffer->tid = static_cast<long>(trace_buffers.size());
+#endif
+        }
+
+        return *buffer;
+    }
+
+    /* records a complete ("X") event for its lifetime when tracing is on */
+    class trace_span_t
+    {
+    public:
+        trace_span_t(char const *name, char const *category, std::string detail = {})
+            : name{name}, category{category}, detail{std::move(detail)},
+              start{tracing.load(std::memory_order_relaxed) ? trace_now() : -1}
+        {
+        }
+
+        trace_span_t(trace_span_t const &) = delete;
+        trace_span_t &operator=(trace_span_t const &) = delete;
+
+        ~trace_span_t()
+        {
+            if (start < 0) return;
+            local_trace_buffer().events.push_back({name, category, start, trace_now() - start, std::move(detail)});
+        }
+
+    private:
+        char const *name;
+        char const *category;
+        std::string detail;
+        std::int64_t start;
+    };
+
+    void print_json_string(std::FILE *out, std::string_view text)
+    {
+        std::fputc('"', out);
+        for (char ch : text)
+        {
+            if (ch == '"' || ch == '\\') std::fprintf(out, "\\%c", ch);
+            else if (static_cast<unsigned char>(ch) < 0x20) std::fprintf(out, "\\u%04x", ch);
+            else std::fputc(ch, out);
+        }
+        std::fputc('"', out);
+    }
+
+    void write_trace(std::string const &path)
+    {
+        std::FILE *out = open_output(path);
+        int const pid = getpid();
+        bool first = true;
+
+        std::fprintf(out, "{\"traceEvents\": [");
+        std::lock_guard<std::mutex> lock{trace_buffers_mutex};
+        for (auto const &buffer : trace_buffers)
+        {
+            for (auto const &event : buffer->events)
+            {
+                std::fprintf(out, "%s\n  {\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %" PRId64
+                             ", \"dur\": %" PRId64 ", \"pid\": %d, \"tid\": %ld",
+                             first ? "" : ",", event.name, event.category, event.start_us, event.duration_us,
+                             pid, buffer->tid);
+                if (!event.detail.empty())
+                {
+                    std::fprintf(out, ", \"args\": {\"detail\": ");
+                    print_json_string(out, event.detail);
+                    std::fprintf(out, "}");
+                }
+                std::fprintf(out, "}");
+                first = false;
+            }
+        }
+        std::fprintf(out, "\n]}\n");
+        std::fclose(out);
+    }
+
+    /* published in posix shared memory by interpret<hook_telemetry> and read by b93 --monitor.
+     * the sequence is odd while an update is in progress, readers retry until they see the same
+     * even value before and after copying */
+    struct telemetry_t
+    {
+        static constexpr std::uint32_t magic_value = 0x62393374;
+
+        std::atomic<std::uint32_t> sequence;
+        std::uint32_t magic;
+        std::uint32_t finished;
+        std::uint32_t tier;
+        std::uint64_t instructions;
+        std::uint64_t output_bytes;
+        std::uint64_t stack_depth;
+        std::int64_t updated_ns;
+        std::int32_t x;
+        std::int32_t y;
+        std::int32_t dir;
+        std::array<char, grid_cells> grid;
+    };
+
+    telemetry_t *telemetry = nullptr;
+    std::uint64_t telemetry_interval = 1 << 16;
+
+    std::int64_t steady_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void publish_telemetry(stats_t const &stats, std::array<std::ptrdiff_t, 2> const &pos,
+                           std::array<std::ptrdiff_t, 2> const &dir, std::size_t stack_depth,
+                           grid_t const &grid, std::uint32_t tier)
+    {
+        std::uint32_t const sequence = telemetry->sequence.load(std::memory_order_relaxed);
+        telemetry->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        telemetry->tier = tier;
+        telemetry->instructions = stats.instructions;
+        telemetry->output_bytes = stats.bytes_out;
+        telemetry->stack_depth = stack_depth;
+        telemetry->updated_ns = steady_ns();
+        telemetry->x = static_cast<std::int32_t>(pos[0]);
+        telemetry->y = static_cast<std::int32_t>(pos[1]);
+        telemetry->dir = static_cast<std::int32_t>(dir_index(dir));
+        telemetry->grid = grid.data;
+
+        telemetry->sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    /* creates and maps the shared memory object for the lifetime of a run */
+    class telemetry_shm_t
+    {
+    public:
+        explicit telemetry_shm_t(std::string_view name) : name{name}
+        {
+            int const fd = shm_open(this->name.c_str(), O_CREAT | O_RDWR, 0644);
+            if (fd < 0 || ftruncate(fd, sizeof(telemetry_t)) != 0)
+            {
+                std::fprintf(stderr, "Error: could not create shared memory %s: %s\n", this->name.c_str(), std::strerror(errno));
+                std::exit(EXIT_FAILURE);
+            }
+
+            void *memory = mmap(nullptr, sizeof(telemetry_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (memory == MAP_FAILED)
+            {
+                std::fprintf(stderr, "Error: could not map shared memory %s: %s\n", this->name.c_str(), std::strerror(errno));
+                std::exit(EXIT_FAILURE);
+            }
+
+            telemetry = new (memory) telemetry_t{};
+            telemetry->magic = telemetry_t::magic_value;
+        }
+
+        telemetry_shm_t(telemetry_shm_t const &) = delete;
+        telemetry_shm_t &operator=(telemetry_shm_t const &) = delete;
+
+        /* monitors that already mapped the object see finished, new ones no longer find it */
+        ~telemetry_shm_t()
+        {
+            telemetry->sequence.fetch_add(1, std::memory_order_relaxed);
+            telemetry->finished = 1;
+            telemetry->sequence.fetch_add(1, std::memory_order_release);
+
+            munmap(telemetry, sizeof(telemetry_t));
+            shm_unlink(name.c_str());
+            telemetry = nullptr;
+        }
+
+    private:
+        std::string name;
+    };
+
+    /* polls a run's telemetry and redraws mips, the cursor and a mini-map of the playfield */
+    int monitor(std::string_view name)
+    {
+        std::string const shm_name{name};
+        int const fd = shm_open(shm_name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+        {
+            std::fprintf(stderr, "Error: could not open shared memory %s: %s\n", shm_name.c_str(), std::strerror(errno));
+            return EXIT_FAILURE;
+        }
+
+        void *memory = mmap(nullptr, sizeof(telemetry_t), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (memory == MAP_FAILED)
+        {
+            std::fprintf(stderr, "Error: could not map shared memory %s: %s\n", shm_name.c_str(), std::strerror(errno));
+            return EXIT_FAILURE;
+        }
+
+        auto const &shared = *static_cast<telemetry_t const *>(memory);
+        if (shared.magic != telemetry_t::magic_value)
+        {
+            std::fprintf(stderr, "Error: %s is not b93 telemetry\n", shm_name.c_str());
+            return EXIT_FAILURE;
+        }
+
+        std::unique_ptr<telemetry_t> const snapshot = std::make_unique<telemetry_t>();
+        std::uint64_t last_instructions = 0;
+        std::int64_t last_ns = 0;
+
+        for (;;)
+        {
+            /* seqlock read */
+            for (;;)
+            {
+                std::uint32_t const before = shared.sequence.load(std::memory_order_acquire);
+                if (before % 2 != 0) continue;
+
+                std::memcpy(reinterpret_cast<char *>(snapshot.get()) + sizeof(std::atomic<std::uint32_t>),
+                            reinterpret_cast<char const *>(&shared) + sizeof(std::atomic<std::uint32_t>),
+                            sizeof(telemetry_t) - sizeof(std::atomic<std::uint32_t>));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (shared.sequence.load(std::memory_order_relaxed) == before) break;
+            }
+
+            double const mips = snapshot->updated_ns > last_ns && last_ns != 0
+                ? static_cast<double>(snapshot->instructions - last_instructions) / ((snapshot->updated_ns - last_ns) / 1e3)
+                : 0.0;
+            if (snapshot->updated_ns != last_ns)
+            {
+                last_instructions = snapshot->instructions;
+                last_ns = snapshot->updated_ns;
+            }
+
+            /* any process can write the object, so indices are checked before use */
+            char const *const tier = snapshot->tier < tier_names.size() ? tier_names[snapshot->tier] : "unknown";
+            char const *const heading = static_cast<std::uint32_t>(snapshot->dir) < dir_names.size() ? dir_names[snapshot->dir] : "unknown";
+
+            std::printf("\x1b[H\x1b[2J%s  %s  %.2f MIPS\n", shm_name.c_str(), tier, mips);
+            std::printf("instructions %" PRIu64 "  output %" PRIu64 " bytes  stack %" PRIu64 "\n",
+                        snapshot->instructions, snapshot->output_bytes, snapshot->stack_depth);
+            std::printf("cursor (%" PRId32 ", %" PRId32 ") heading %s\n\n", snapshot->x, snapshot->y, heading);
+
+            /* a 2x2 block of cells per charecter: the cursor, code or blank */
+            for (std::size_t y = 0; y < max_row_size; y += 2)
+            {
+                for (std::size_t x = 0; x < max_col_size; x += 2)
+                {
+                    bool cursor = false, code = false;
+                    for (std::size_t cell = 0; cell < 4; ++cell)
+                    {
+                        std::size_t const cx = x + cell % 2, cy = y + cell / 2;
+                        if (cy >= max_row_size) continue;
+
+                        char const ch = snapshot->grid[cy * (max_col_size + 1) + cx];
+                        cursor |= static_cast<std::size_t>(snapshot->x) == cx && static_cast<std::size_t>(snapshot->y) == cy;
+                        code |= ch != ' ' && ch != '\0';
+                    }
+                    std::putchar(cursor ? '@' : code ? '.' : ' ');
+                }
+                std::putchar('\n');
+            }
+            std::fflush(stdout);
+
+            if (snapshot->finished) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        }
+
+        munmap(memory, sizeof(telemetry_t));
+        return EXIT_SUCCESS;
+    }
+
+    /* the flight recorder: the last records.size() dispatches, dumped to b93-PID.flight on SIGUSR1,
+     * SIGSEGV, SIGFPE or when the step budget runs out */
+    struct flight_record_t
+    {
+        std::uint8_t x;
+        std::uint8_t y;
+        char opcode;
+        std::uint8_t dir;
+        std::int32_t top;
+    };
+
+    static_assert(sizeof(flight_record_t) == 8, "a flight record is written out as is");
+
+    struct flight_header_t
+    {
+        std::array<char, 4> magic;
+        std::uint32_t capacity;
+        std::uint64_t count;
+
+        /* the signal that triggered the dump, 0 for an exhausted step budget */
+        std::int32_t reason;
+        std::uint32_t cols;
+    };
+
+    constexpr std::array<char, 4> flight_magic {'B', '9', '3', 'F'};
+
+    /* 16M records of 8 bytes take 128MB, and the capacity has to fit the header */
+    constexpr std::size_t max_flight_records = std::size_t{1} << 24;
+
+    struct flight_recorder_t
+    {
+        std::vector<flight_record_t> records;
+        std::size_t mask = 0;
+        std::atomic<std::uint64_t> count {0};
+
+        /* the playfield of the running interpret(), null outside of it */
+        std::atomic<grid_t const *> grid {nullptr};
+
+        /* built before arming so the signal handler only needs write() */
+        std::array<char, 64> path = {};
+        std::array<char, 96> message = {};
+        std::size_t message_size = 0;
+    };
+
+    flight_recorder_t flight;
+
+    void record_flight(std::array<std::ptrdiff_t, 2> const &pos, std::array<std::ptrdiff_t, 2> const &dir,
+                       char opcode, std::vector<std::int32_t> const &stack)
+    {
+        std::uint64_t const count = flight.count.load(std::memory_order_relaxed);
+        flight.records[count & flight.mask] = {static_cast<std::uint8_t>(pos[0]), static_cast<std::uint8_t>(pos[1]), opcode,
+                                               static_cast<std::uint8_t>(dir_index(dir)), stack.empty() ? 0 : stack.back()};
+        std::atomic_signal_fence(std::memory_order_release);
+        flight.count.store(count + 1, std::memory_order_relaxed);
+    }
+
+    /* async-signal-safe */
+    void dump_flight_recorder(int reason)
+    {
+        int const fd = open(flight.path.data(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return;
+
+        std::atomic_signal_fence(std::memory_order_acquire);
+        flight_header_t const header {flight_magic, static_cast<std::uint32_t>(flight.records.size()),
+                                      flight.count.load(std::memory_order_relaxed), reason, max_col_size + 1};
+        static std::array<char, grid_cells> const blank = {};
+        grid_t const *grid = flight.grid.load(std::memory_order_relaxed);
+
+        bool ok = write(fd, &header, sizeof(header)) == sizeof(header);
+        ok = ok && write(fd, grid ? grid->data.data() : blank.data(), grid_cells) == static_cast<ssize_t>(grid_cells);
+        ok = ok && write(fd, flight.records.data(), flight.records.size() * sizeof(flight_record_t)) ==
+                   static_cast<ssize_t>(flight.records.size() * sizeof(flight_record_t));
+        close(fd);
+
+        if (ok && write(STDERR_FILENO, flight.message.data(), flight.message_size) < 0) return;
+    }
+
+    void on_flight_signal(int signal)
+    {
+        /* SIGSEGV and SIGFPE were installed with SA_RESETHAND, returning re-executes the faulting
+         * instruction under the default action */
+        dump_flight_recorder(signal);
+    }
+
+    /* sizes the ring to the next power of two and installs the signal handlers */
+    void arm_flight_recorder(std::size_t capacity)
+    {
+        std::size_t size = 1;
+        while (size < std::min(capacity, max_flight_records)) size *= 2;
+
+        flight.records.assign(size, {});
+        flight.mask = size - 1;
+        flight.count.store(0);
+        std::snprintf(flight.path.data(), flight.path.size(), "b93-%d.flight", getpid());
+        flight.message_size = static_cast<std::size_t>(
+            std::snprintf(flight.message.data(), flight.message.size(), "flight recorder dumped to %s\n", flight.path.data()));
+
+        struct sigaction action = {};
+        action.sa_handler = on_flight_signal;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGUSR1, &action, nullptr);
+
+        action.sa_flags = SA_RESETHAND;
+        sigaction(SIGSEGV, &action, nullptr);
+        sigaction(SIGFPE, &action, nullptr);
+    }
+
+    /* prints a dump: older records as a list, then the newest ones beside the rows of the playfield */
+    int decode_flight(std::string_view path)
+    {
+        std::ifstream file {std::string{path}, std::ios::binary};
+        flight_header_t header = {};
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != flight_magic ||
+            header.cols != max_col_size + 1)
+        {
+            std::fprintf(stderr, "Error: %.*s is not a b93 flight recorder dump\n", static_cast<int>(path.size()), path.data());
+            return EXIT_FAILURE;
+        }
+
+        /* arm_flight_recorder() only writes power of two capacities up to max_flight_records */
+        if (header.capacity == 0 || header.capacity > max_flight_records || (header.capacity & (header.capacity - 1)) != 0)
+        {
+            std::fprintf(stderr, "Error: %.*s has an invalid capacity of %" PRIu32 "\n", static_cast<int>(path.size()), path.data(), header.capacity);
+            return EXIT_FAILURE;
+        }
+
+        std::array<char, grid_cells> grid = {};
+        std::vector<flight_record_t> records(header.capacity);
+        if (!file.read(grid.data(), grid.size()) ||
+            !file.read(reinterpret_cast<char *>(records.data()), records.size() * sizeof(flight_record_t)))
+        {
+            std::fprintf(stderr, "Error: %.*s is truncated\n", static_cast<int>(path.size()), path.data());
+            return EXIT_FAILURE;
+        }
+
+        std::uint64_t const first = header.count > header.capacity ? header.count - header.capacity : 0;
+        std::printf("%" PRIu64 " instructions recorded, showing the last %" PRIu64 ", dumped by %s\n",
+                    header.count, header.count - first,
+                    header.reason == 0 ? "an exhausted step budget" : strsignal(header.reason));
+
+        auto print_record = [&](std::uint64_t index)
+        {
+            auto const &record = records[index % header.capacity];
+            unsigned char const ch = static_cast<unsigned char>(record.opcode);
+            std::printf("#%-10" PRIu64 " (%2u,%2u) %-5s ", index, record.x, record.y, dir_names[record.dir & 3]);
+            if (ch >= ' ' && ch < 0x7f) std::printf("'%c'", ch);
+            else std::printf("#%u", ch);
+            std::printf("  top %" PRId32, record.top);
+        };
+
+        std::uint64_t const beside = std::min<std::uint64_t>(header.count - first, max_row_size);
+        for (std::uint64_t i = first; i < header.count - beside; ++i)
+        {
+            print_record(i);
+            std::printf("\n");
+        }
+
+        /* the last position is marked in the playfield */
+        auto const &last = records[(header.count - 1) % header.capacity];
+        for (std::size_t y = 0; y < max_row_size; ++y)
+        {
+            for (std::size_t x = 0; x < max_col_size; ++x)
+            {
+                char const ch = grid[y * header.cols + x];
+                bool const here = header.count > 0 && last.x == x && last.y == y;
+                std::putchar(here ? '*' : ch >= ' ' && ch < 0x7f ? ch : ' ');
+            }
+
+            std::printf(" | ");
+            std::uint64_t const index = header.count - beside + y;
+            if (y < beside) print_record(index);
+            std::printf("\n");
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /* the nondeterministic inputs of a run: ? outcomes packed four to a byte, and the values ~ and &
+     * pushed as zigzag varint deltas from the previous one. replay feeds them back in the same order,
+     * so a run reproduces without reading stdin or drawing from the prng */
+    class event_log_t
+    {
+    public:
+        enum class mode_t { off, record, replay };
+
+        mode_t mode = mode_t::off;
+
+        /* set when a replay asked for more events than were recorded */
+        bool exhausted = false;
+
+        /* outcomes gather in a word that is flushed every 32 draws */
+        void record_random(std::size_t dir)
+        {
+            pending_random |= static_cast<std::uint64_t>(dir) << (random_count % 32 * 2);
+            if (++random_count % 32 == 0)
+            {
+                flush_random(8);
+                pending_random = 0;
+            }
+        }
+
+        bool replay_random(std::size_t &dir)
+        {
+            if (random_read == random_count)
+            {
+                exhausted = true;
+                return false;
+            }
+
+            dir = random[random_read / 4] >> (random_read % 4 * 2) & 3;
+            ++random_read;
+            return true;
+        }
+
+        void record_input(std::int32_t value)
+        {
+            std::int64_t const delta = static_cast<std::int64_t>(value) - last_input;
+            write_varint(static_cast<std::uint64_t>(delta) << 1 ^ static_cast<std::uint64_t>(delta >> 63));
+            last_input = value;
+            ++input_count;
+        }
+
+        bool replay_input(std::int32_t &value)
+        {
+            std::uint64_t zigzag = 0;
+            if (input_read == input_count || !read_varint(zigzag))
+            {
+                exhausted = true;
+                return false;
+            }
+
+            last_input += static_cast<std::int64_t>(zigzag >> 1) ^ -static_cast<std::int64_t>(zigzag & 1);
+            value = static_cast<std::int32_t>(last_input);
+            ++input_read;
+            return true;
+        }
+
+        /* how many outcomes a replay fed, and going back to an earlier count */
+        std::size_t random_position() const { return random_read; }
+        void seek_random(std::size_t position) { random_read = std::min<std::uint64_t>(position, random_count); }
+
+        /* turns a recorded log into one that replays from the first event */
+        void rewind()
+        {
+            flush_pending();
+            mode = mode_t::replay;
+            exhausted = false;
+            random_read = 0;
+            input_offset = 0;
+            input_read = 0;
+            last_input = 0;
+        }
+
+        /* magic, the event counts as varints, then the random bytes and the input bytes */
+        bool save(std::string const &path)
+        {
+            flush_pending();
+
+            std::ofstream file {path, std::ios::binary};
+            event_log_t header;
+            header.write_varint(random_count);
+            header.write_varint(input_count);
+            header.write_varint(inputs.size());
+
+            file.write(log_magic.data(), log_magic.size());
+            file.write(reinterpret_cast<char const *>(header.inputs.data()), header.inputs.size());
+            file.write(reinterpret_cast<char const *>(random.data()), random.size());
+            file.write(reinterpret_cast<char const *>(inputs.data()), inputs.size());
+            return file.good();
+        }
+
+        bool load(std::string const &path)
+        {
+            std::ifstream file {path, std::ios::binary};
+            std::vector<std::uint8_t> const bytes {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+            if (bytes.size() < log_magic.size() || !std::equal(log_magic.begin(), log_magic.end(), bytes.begin())) return false;
+
+            event_log_t header;
+            header.inputs.assign(bytes.begin() + log_magic.size(), bytes.end());
+            std::uint64_t input_bytes = 0;
+            if (!header.read_varint(random_count) || !header.read_varint(input_count) || !header.read_varint(input_bytes)) return false;
+
+            std::size_t const start = log_magic.size() + header.input_offset;
+            std::size_t const random_bytes = (random_count + 3) / 4;
+            if (bytes.size() - start != random_bytes + input_bytes) return false;
+
+            random.assign(bytes.begin() + start, bytes.begin() + start + random_bytes);
+            inputs.assign(bytes.begin() + start + random_bytes, bytes.end());
+            return true;
+        }
+
+    private:
+        static constexpr std::array<char, 4> log_magic {'B', '9', '3', 'R'};
+
+        void flush_random(std::size_t bytes)
+        {
+            for (std::size_t i = 0; i < bytes; ++i) random.push_back(static_cast<std::uint8_t>(pending_random >> (i * 8)));
+        }
+
+        /* writes the draws of a partly filled word once */
+        void flush_pending()
+        {
+            if (random.size() == (random_count + 3) / 4) return;
+
+            flush_random((random_count % 32 + 3) / 4);
+            pending_random = 0;
+        }
+
+        void write_varint(std::uint64_t value)
+        {
+            for (; value >= 0x80; value >>= 7) inputs.push_back(static_cast<std::uint8_t>(value | 0x80));
+            inputs.push_back(static_cast<std::uint8_t>(value));
+        }
+
+        bool read_varint(std::uint64_t &value)
+        {
+            value = 0;
+            for (unsigned shift = 0; input_offset < inputs.size() && shift < 64; shift += 7)
+            {
+                std::uint8_t const byte = inputs[input_offset++];
+                value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0) return true;
+            }
+
+            return false;
+        }
+
+        std::vector<std::uint8_t> random;
+        std::uint64_t pending_random = 0;
+        std::uint64_t random_count = 0;
+        std::uint64_t random_read = 0;
+        std::vector<std::uint8_t> inputs;
+        std::size_t input_offset = 0;
+        std::uint64_t input_count = 0;
+        std::uint64_t input_read = 0;
+        std::int64_t last_input = 0;
+    };
+
+    /* & and ~ for every engine, under a span so the trace shows how long the run waited for input.
+     * the value comes from the replay log, or from stdin and is recorded. false when a replay runs out */
+    template <unsigned Hooks>
+    bool read_input(char opcode, event_log_t &events, stats_t &stats, std::int32_t &value)
+    {
+        trace_span_t const span{opcode == '&' ? "read &" : "read ~", "io"};
+        value = -1;
+        if (events.mode == event_log_t::mode_t::replay) return events.replay_input(value);
+
+        if (opcode == '&')
+        {
+            int consumed = 0;
+            std::scanf("%" SCNi32 "%n", &value, &consumed);
+            if constexpr ((Hooks & hook_count) != 0) stats.bytes_in += consumed;
+        }
+        else
+        {
+            /* -1 at the end of the input */
+            int const ch = std::getchar();
+            if constexpr ((Hooks & hook_count) != 0) stats.bytes_in += ch != EOF;
+            if (ch != EOF) value = static_cast<char>(ch);
+        }
+        if (events.mode == event_log_t::mode_t::record) events.record_input(value);
+        return true;
+    }
+}
+
+/* Hooks selects what an instantiation observes: hook_count counts instructions and bytes and enforces
+ * the step budget, hook_stats fills in the rest of stats, hook_probe publishes the state for the
+ * sampling profiler, hook_telemetry updates the shared memory telemetry and hook_flight feeds the
+ * flight recorder. interpret<0> compiles without any of it.
+ * events records or replays the ? outcomes and the input.
+ * returns false when the step budget or the replayed events ran out before the program ended */
+template <unsigned Hooks>
+bool interpret(grid_t grid, options_t const &options, stats_t &stats, event_log_t &events)
+{
+    auto &[data, rows, cols] = grid;
+    bool const extensions = options.extensions;
+    std::uint64_t const max_steps = options.max_steps;
+    if constexpr ((Hooks & hook_flight) != 0) flight.grid.store(&grid);
+
+    /* create a stack */
+    std::vector<std::int32_t> stack;
+    auto push = [&](std::int32_t value) -> void
+    {
+        stack.push_back(value);
+        if constexpr ((Hooks & hook_stats) != 0) stats.stack_high_water = std::max(stats.stack_high_water, stack.size());
+    };
+    auto pop = [&]() -> std::int32_t
+    {
+        if (stack.empty())
+        {
+            if constexpr ((Hooks & hook_stats) != 0) ++stats.empty_pops;
+            return 0;
+        } 
+        else
+        {
+            std::int32_t temp = stack.back();
+            stack.pop_back();
+            return temp;
+        }
+    };
+    on_exit_t const save_final_state {[&] { if (options.final_state != nullptr) *options.final_state = {stack, data}; }};
+    on_exit_t const save_stack_bytes {[&]
+    {
+        if constexpr ((Hooks & hook_count) != 0) stats.stack_bytes = stack.capacity() * sizeof(std::int32_t);
+    }};
+
+    /* hold the position of the cursor and the direction of it */
+    std::array<std::ptrdiff_t, 2> pos = {}, dir = {1, 0};
+    /* a step leaves the grid by at most one cell, so wrapping is a compare per axis rather than a
+     * signed modulo */
+    auto move = [&, cols = static_cast<std::ptrdiff_t>(cols), rows = static_cast<std::ptrdiff_t>(rows)]() -> void
+    {
+        pos[0] += dir[0];
+        pos[1] += dir[1];
+        if (pos[0] < 0) pos[0] = cols - 1;
+        else if (pos[0] == cols) pos[0] = 0;
+        if (pos[1] < 0) pos[1] = rows - 1;
+        else if (pos[1] == rows) pos[1] = 0;
+    };
+
+    /* the directions: south, north, east, west */
+    constexpr std::array<std::array<std::ptrdiff_t, 2>, 4> dirs {{{0, 1}, {0, -1}, {-1, 0}, {1, 0}}};
+
+    std::uint64_t telemetry_countdown = telemetry_interval;
+
+    /* however the run ends, the monitor's last frame shows where it stopped */
+    on_exit_t const final_telemetry {[&]
+    {
+        if constexpr ((Hooks & hook_telemetry) != 0) publish_telemetry(stats, pos, dir, stack.size(), grid, 0);
+    }};
+
+    /* setup an prng */
+    lazy_prng_t prng {options};
+    string_literals_t literals;
+
+    for (;;)
+    {
+        char const ins = data[pos[1] * cols + pos[0]];
+        if constexpr ((Hooks & hook_probe) != 0) publish_probe(pos, dir, stack.size(), 0);
+        if constexpr ((Hooks & hook_count) != 0)
+        {
+            if (stats.instructions == max_steps) return false;
+            ++stats.instructions;
+        }
+        if constexpr ((Hooks & hook_flight) != 0) record_flight(pos, dir, ins, stack);
+        if constexpr ((Hooks & hook_telemetry) != 0)
+        {
+            if (--telemetry_countdown == 0)
+            {
+                publish_telemetry(stats, pos, dir, stack.size(), grid, 0);
+                telemetry_countdown = telemetry_interval;
+            }
+        }
+        if constexpr ((Hooks & hook_stats) != 0)
+        {
+            ++stats.opcodes[static_cast<unsigned char>(ins)];
+            std::size_t const cell = pos[1] * cols + pos[0];
+            ++stats.heat[cell][dir_index(dir)];
+            stats.executions_after_write[cell] += stats.writes[cell] != 0;
+        }
+
+        /* see https://catseye.tc/view/Befunge-93/doc/Befunge-93.markdown for what every instruction means */
+        switch (ins)
+        {
+            case '+':
+            {
+                push(pop() + pop());
+            } break;
+
+            case '-':
+            {
+                std::int32_t const a = pop();
+                std::int32_t const b = pop();
+                push(b - a);
+            } break;
+
+            case '/':
+            {
+                std::int32_t const a = pop();
+                std::int32_t const b = pop();
+                push(divide(b, a));
+            } break;
+
+            case '*':
+            {
+                push(pop() * pop());
+            } break;
+
+            case '%':
+            {
+                std::int32_t const a = pop();
+                std::int32_t const b = pop();
+                push(modulo(b, a));
+            } break;
+
+            case '!':
+            {
+                if (stack.empty())
+                {
+                    if constexpr ((Hooks & hook_stats) != 0) ++stats.empty_pops;
+
+                    /* 0 == 0 is true */
+                    push(1);
+                } 
+                else
+                {
+                    stack.back() = stack.back() == 0;
+                }
+            } break;
+
+            case '`':
+            {
+                std::int32_t a = pop();
+                std::int32_t b = pop();
+                push(b > a);
+            } break;
+
+            case '^':
+            {
+                dir = dirs[1];
+            } break;
+
+            case 'v':
+            {
+                dir = dirs[0];
+            } break;
+
+            case '>':
+            {
+                dir = dirs[3];
+            } break;
+
+            case '<':
+            {
+                dir = dirs[2];
+            } break;
+
+            case '_':
+            {
+                dir = pop() != 0 ? dirs[2] : dirs[3];
+            } break;
+
+            case '|':
+            {
+                dir = pop() != 0 ? dirs[1] : dirs[0];
+            } break;
+
+            case '"':
+            {
+                /* push the charecters up to the closing quote at once and continue from it */
+                auto const literal = literals.get(grid, pos[1] * cols + pos[0], dir);
+                stack.insert(stack.end(), literal.chars, literal.chars + literal.size);
+                if constexpr ((Hooks & hook_stats) != 0) stats.stack_high_water = std::max(stats.stack_high_water, stack.size());
+                pos = {static_cast<std::ptrdiff_t>(literal.exit % cols), static_cast<std::ptrdiff_t>(literal.exit / cols)};
+            } break;
+
+            case ':':
+            {
+                if constexpr ((Hooks & hook_stats) != 0) stats.empty_pops += stack.empty();
+                push(stack.empty() ? 0 : stack.back());
+            } break;
+
+            case '\\':
+            {
+                /* NOTE: this is needed because the \ op
+                 * is the same as:
+                 * a = pop()
+                 * b = pop()
+                 * push(a)
+                 * push(b)
+                 */
+                if constexpr ((Hooks & hook_stats) != 0) stats.empty_pops += stack.size() < 2 ? 2 - stack.size() : 0;
+                switch (stack.size())
+                {
+                    default:
+                    {
+                        std::swap(stack.end()[-1], stack.end()[-2]);
+                    } break;
+
+                    case 0: break;
+
+                    case 1:
+                    {
+                        push(0);
+                    } break;
+                }
+            } break;
+
+            case '$':
+            {
+                pop();
+            } break;
+
+            case '.':
+            {
+                std::int32_t value = pop();
+                int const written = std::printf("%" PRId32 " ", value);
+                if constexpr ((Hooks & hook_count) != 0) stats.bytes_out += written > 0 ? written : 0;
+            } break;
+
+            case ',':
+            {
+                char value = static_cast<char>(pop());
+                std::putchar(value);
+                if constexpr ((Hooks & hook_count) != 0) ++stats.bytes_out;
+            } break;
+
+            case '#':
+            {
+                move();
+            } break;
+
+            case 'g':
+            {
+
+                std::ptrdiff_t y = static_cast<std::ptrdiff_t>(pop());
+                std::ptrdiff_t x = static_cast<std::ptrdiff_t>(pop());
+
+                bool const in_bounds = x >= 0 && x < static_cast<std::ptrdiff_t>(max_col_size) &&
+                                       y >= 0 && y < static_cast<std::ptrdiff_t>(max_row_size);
+                if constexpr ((Hooks & hook_stats) != 0)
+                {
+                    ++stats.gets;
+                    stats.gets_out_of_bounds += !in_bounds;
+                    if (in_bounds) ++stats.reads[y * cols + x];
+                }
+
+                push(in_bounds ? data[y * cols + x] : 0);
+            } break;
+
+            case 'p':
+            {
+                std::ptrdiff_t y = (static_cast<std::ptrdiff_t>(pop()));
+                std::ptrdiff_t x = (static_cast<std::ptrdiff_t>(pop()));
+                std::int32_t value = pop();
+
+                /* check for out of bounds */
+                bool const in_bounds = x >= 0 && x < static_cast<std::ptrdiff_t>(max_col_size) &&
+                                       y >= 0 && y < static_cast<std::ptrdiff_t>(max_row_size);
+                if constexpr ((Hooks & hook_stats) != 0)
+                {
+                    ++stats.puts;
+                    stats.puts_out_of_bounds += !in_bounds;
+                    if (in_bounds)
+                    {
+                        ++stats.writes[y * cols + x];
+                        ++stats.put_sites[static_cast<std::uint32_t>(pos[1] * cols + pos[0]) << 16 |
+                                          static_cast<std::uint32_t>(y * cols + x)];
+                    }
+                }
+
+                if (in_bounds && data[y * cols + x] != truncate(value))
+                {
+                    data[y * cols + x] = truncate(value);
+                    literals.invalidate(x, y);
+                }
+            } break;
+
+            case '&':
+            case '~':
+            {
+                std::int32_t value;
+                if (!read_input<Hooks>(ins, events, stats, value)) return false;
+                push(value);
+            } break;
+
+            /* exit the program */
+            case '@': return true;
+
+            /* for a number push its numeric value onto the stack */
             case '0':
             case '1':
             case '2':
@@ -314,68 +1972,2531 @@ void interpret(std::string_view filepath, bool extensions)
             case '8':
             case '9':
             {
-                push(ins - '0');
-            } break;
+                push(ins - '0');
+            } break;
+
+            case 'a':
+            case 'b':
+            case 'c':
+            case 'd':
+            case 'e':
+            case 'f':
+            {
+                if (!extensions) break;
+
+                push(ins - 'a' + 10);
+            } break;
+
+            case '?':
+            {
+                if constexpr ((Hooks & hook_stats) != 0) ++stats.random_draws;
+
+                std::size_t draw;
+                if (events.mode == event_log_t::mode_t::replay)
+                {
+                    if (!events.replay_random(draw)) return false;
+                }
+                else
+                {
+                    draw = prng.draw();
+                    if (events.mode == event_log_t::mode_t::record) events.record_random(draw);
+                }
+                dir = dirs[draw];
+            } break;
+
+            case '\'':
+            {
+                if (!extensions) break;
+
+                move();
+                push(data[pos[1] * cols + pos[0]]);
+            } break;
+        }
+
+        move();
+    }
+}
+
+namespace
+{
+    /* the instructions of the decoded engine. extensions are resolved when a cell is decoded, so a
+     * cell that does nothing in the current mode decodes to nop */
+    enum class op_t : std::uint8_t
+    {
+        nop, add, subtract, divide, multiply, modulo, logical_not, greater,
+        south, north, west, east, horizontal_if, vertical_if,
+        string_mode, duplicate, swap, discard, output_int, output_char, bridge,
+        get, put, input_int, input_char, end, push, random, fetch, trap
+    };
+
+    /* the playfield decoded ahead of time: an instruction and an immediate per cell, and the cell one
+     * step away in each direction (indexed like dirs) so moving is a lookup */
+    struct decoded_program_t
+    {
+        std::array<op_t, grid_cells> ops;
+        std::array<std::int8_t, grid_cells> values;
+        std::array<std::array<std::uint16_t, 4>, grid_cells> next;
+    };
+
+    op_t decode_cell(char ch, bool extensions, std::int8_t &value)
+    {
+        value = 0;
+        switch (ch)
+        {
+            case '+': return op_t::add;
+            case '-': return op_t::subtract;
+            case '/': return op_t::divide;
+            case '*': return op_t::multiply;
+            case '%': return op_t::modulo;
+            case '!': return op_t::logical_not;
+            case '`': return op_t::greater;
+            case 'v': return op_t::south;
+            case '^': return op_t::north;
+            case '<': return op_t::west;
+            case '>': return op_t::east;
+            case '_': return op_t::horizontal_if;
+            case '|': return op_t::vertical_if;
+            case '"': return op_t::string_mode;
+            case ':': return op_t::duplicate;
+            case '\\': return op_t::swap;
+            case '$': return op_t::discard;
+            case '.': return op_t::output_int;
+            case ',': return op_t::output_char;
+            case '#': return op_t::bridge;
+            case 'g': return op_t::get;
+            case 'p': return op_t::put;
+            case '&': return op_t::input_int;
+            case '~': return op_t::input_char;
+            case '@': return op_t::end;
+            case '?': return op_t::random;
+            case '\'': return extensions ? op_t::fetch : op_t::nop;
+        }
+
+        if (ch >= '0' && ch <= '9')
+        {
+            value = static_cast<std::int8_t>(ch - '0');
+            return op_t::push;
+        }
+
+        if (extensions && ch >= 'a' && ch <= 'f')
+        {
+            value = static_cast<std::int8_t>(ch - 'a' + 10);
+            return op_t::push;
+        }
+
+        return op_t::nop;
+    }
+
+    void decode(grid_t const &grid, bool extensions, decoded_program_t &program)
+    {
+        std::size_t const rows = grid.rows, cols = grid.cols;
+        for (std::size_t y = 0; y < rows; ++y)
+        {
+            for (std::size_t x = 0; x < cols; ++x)
+            {
+                std::size_t const cell = y * cols + x;
+                program.ops[cell] = decode_cell(grid.data[cell], extensions, program.values[cell]);
+                program.next[cell] = {static_cast<std::uint16_t>((y + 1) % rows * cols + x),
+                                      static_cast<std::uint16_t>((y + rows - 1) % rows * cols + x),
+                                      static_cast<std::uint16_t>(y * cols + (x + cols - 1) % cols),
+                                      static_cast<std::uint16_t>(y * cols + (x + 1) % cols)};
+            }
+        }
+    }
+
+    /* the bytes a value needs as a signed integer: 1, 2 or 4 */
+    constexpr std::size_t value_width(std::int32_t value)
+    {
+        return value == static_cast<std::int8_t>(value) ? 1 : value == static_cast<std::int16_t>(value) ? 2 : 4;
+    }
+
+    /* a stack of int32 values stored as segments of 1, 2 or 4 byte values in one byte buffer. a push
+     * that does not fit the top segment widens it when it is short and starts a wider segment
+     * otherwise. values on a wide top segment are repacked in chunks once enough arrived since the
+     * last repack, so narrow values that end up below a wide one (a table growing under a loop
+     * counter) still shrink. a push that fits the top segment is a compare for the width, one for
+     * the room left and a store, and a pop is a load and a compare for the segment boundary */
+    class compact_stack_t
+    {
+    public:
+        /* every value takes at least a byte */
+        bool empty() const { return end == 0; }
+        std::size_t size() const { return below + top_count(); }
+
+        std::int32_t back() const { return load(end - width, width); }
+
+        void push_back(std::int32_t value)
+        {
+            if (static_cast<std::uint32_t>(value) + fit_bias > fit_range || end + width > limit)
+            {
+                push_slow(value);
+                return;
+            }
+
+            store(end, width, value);
+            end += width;
+        }
+
+        void pop_back()
+        {
+            end -= width;
+            if (end == begin) resume_segment();
+        }
+
+        std::int32_t pop_value()
+        {
+            end -= width;
+            std::int32_t const value = load(end, width);
+            if (end == begin) resume_segment();
+            return value;
+        }
+
+        void replace_back(std::int32_t value)
+        {
+            if (static_cast<std::uint32_t>(value) + fit_bias <= fit_range)
+            {
+                store(end - width, width, value);
+                return;
+            }
+
+            pop_back();
+            push_back(value);
+        }
+
+        /* in place when both values are on the top segment */
+        void swap_back()
+        {
+            if (end - begin >= 2 * width)
+            {
+                std::int32_t const top = load(end - width, width);
+                store(end - width, width, load(end - 2 * width, width));
+                store(end - 2 * width, width, top);
+                return;
+            }
+
+            std::int32_t const top = pop_value();
+            std::int32_t const next = pop_value();
+            push_back(top);
+            push_back(next);
+        }
+
+        /* the values from the bottom up */
+        std::vector<std::int32_t> values() const
+        {
+            std::vector<std::int32_t> result;
+            result.reserve(size());
+            std::size_t offset = 0;
+            auto const append = [&](std::size_t segment_width, std::size_t segment_count)
+            {
+                for (std::size_t i = 0; i < segment_count; ++i, offset += segment_width) result.push_back(load(offset, segment_width));
+            };
+
+            for (auto const &segment : segments) append(segment.width, segment.count);
+            append(width, top_count());
+            return result;
+        }
+
+        /* the byte buffer and the segment list */
+        std::size_t allocated() const { return capacity + segments.capacity() * sizeof(segment_t); }
+
+    private:
+        /* a top segment up to this long is widened in place rather than left below a new one */
+        static constexpr std::size_t widen_limit = 64;
+
+        /* repacking re-encodes this many values at a time at the width the widest of them needs,
+         * and runs once four chunks arrived on the top segment since the last time */
+        static constexpr std::size_t repack_chunk = 64;
+        static constexpr std::size_t repack_interval = 4 * repack_chunk;
+
+        struct segment_t
+        {
+            std::size_t count;
+            std::size_t width;
+        };
+
+        std::size_t top_count() const { return (end - begin) / width; }
+
+        std::int32_t load(std::size_t offset, std::size_t value_bytes) const
+        {
+            switch (value_bytes)
+            {
+                case 1: return static_cast<std::int8_t>(bytes[offset]);
+
+                case 2:
+                {
+                    std::int16_t value;
+                    std::memcpy(&value, &bytes[offset], sizeof(value));
+                    return value;
+                }
+
+                default:
+                {
+                    std::int32_t value;
+                    std::memcpy(&value, &bytes[offset], sizeof(value));
+                    return value;
+                }
+            }
+        }
+
+        void store(std::size_t offset, std::size_t value_bytes, std::int32_t value)
+        {
+            switch (value_bytes)
+            {
+                case 1: bytes[offset] = static_cast<std::uint8_t>(value); break;
+
+                case 2:
+                {
+                    std::int16_t const narrow = static_cast<std::int16_t>(value);
+                    std::memcpy(&bytes[offset], &narrow, sizeof(narrow));
+                } break;
+
+                default: std::memcpy(&bytes[offset], &value, sizeof(value)); break;
+            }
+        }
+
+        /* grows like a vector, without touching the new bytes so unused capacity costs no memory */
+        void reserve(std::size_t size)
+        {
+            if (size <= capacity) return;
+
+            capacity = std::max({size, capacity * 2, std::size_t{256}});
+            std::unique_ptr<std::uint8_t[]> grown {new std::uint8_t[capacity]};
+            if (end != 0) std::memcpy(grown.get(), bytes.get(), end);
+            bytes = std::move(grown);
+            limit = std::min(capacity, repack_at);
+        }
+
+        /* the top segment starts at byte new_begin, and its first settled values are not repacked
+         * again. the fast paths only compare against fit_*, limit and begin */
+        void reset_top(std::size_t new_begin, std::size_t new_width, std::size_t settled)
+        {
+            begin = new_begin;
+            width = new_width;
+            fit_bias = new_width == 4 ? 0 : 1u << (new_width * 8 - 1);
+            fit_range = new_width == 4 ? UINT32_MAX : (1u << new_width * 8) - 1;
+            repack_from = begin + settled * width;
+            repack_at = repack_from + repack_interval * width;
+            limit = std::min(capacity, repack_at);
+        }
+
+        /* re-encodes the top segment at a larger width, from the top down so no value is overwritten
+         * before it is read */
+        void widen(std::size_t new_width)
+        {
+            std::size_t const count = top_count();
+            reserve(begin + count * new_width);
+            for (std::size_t i = count; i-- > 0;) store(begin + i * new_width, new_width, load(begin + i * width, width));
+
+            end = begin + count * new_width;
+            reset_top(begin, new_width, 0);
+        }
+
+        void start_segment(std::size_t new_width)
+        {
+            segments.push_back({top_count(), width});
+            below += segments.back().count;
+            reset_top(end, new_width, 0);
+        }
+
+        /* the segment below becomes the top again once the top is empty, as it was left */
+        void resume_segment()
+        {
+            if (segments.empty()) return;
+
+            segment_t const resumed = segments.back();
+            segments.pop_back();
+            below -= resumed.count;
+            reset_top(begin - resumed.count * resumed.width, resumed.width, resumed.count);
+        }
+
+        /* re-encodes the values that arrived since the last repack a chunk at a time, all but the
+         * last chunk, merging chunks of the same width into one segment. values only move down and
+         * each is read before anything is written over it */
+        void repack()
+        {
+            std::size_t const settled = (repack_from - begin) / width;
+            if (width == 1)
+            {
+                reset_top(begin, width, top_count());
+                return;
+            }
+
+            std::size_t const fresh = (end - repack_from) / width;
+            std::size_t const packed = (fresh - repack_chunk) / repack_chunk * repack_chunk;
+            std::size_t const tail = fresh - packed;
+
+            /* the segment being built starts as the settled values, or as the segment below when
+             * there are none and the first chunk matches it */
+            segment_t building = {settled, width};
+            std::size_t building_begin = begin;
+            std::size_t written = repack_from;
+            for (std::size_t chunk = 0; chunk < packed; chunk += repack_chunk)
+            {
+                std::size_t const from = repack_from + chunk * width;
+                std::size_t chunk_width = 1;
+                for (std::size_t i = 0; i < repack_chunk; ++i) chunk_width = std::max(chunk_width, value_width(load(from + i * width, width)));
+
+                if (building.count != 0 && building.width != chunk_width)
+                {
+                    segments.push_back(building);
+                    below += building.count;
+                    building = {0, chunk_width};
+                    building_begin = written;
+                }
+                else if (building.count == 0)
+                {
+                    building = {0, chunk_width};
+                    if (!segments.empty() && segments.back().width == chunk_width)
+                    {
+                        building = segments.back();
+                        segments.pop_back();
+                        below -= building.count;
+                        building_begin -= building.count * building.width;
+                    }
+                }
+
+                for (std::size_t i = 0; i < repack_chunk; ++i, written += chunk_width)
+                {
+                    store(written, chunk_width, load(from + i * width, width));
+                }
+                building.count += repack_chunk;
+            }
+
+            /* the tail keeps its width and stays on the last chunk when they match */
+            std::memmove(&bytes[written], &bytes[repack_from + packed * width], tail * width);
+            end = written + tail * width;
+            if (building.count != 0 && building.width == width)
+            {
+                reset_top(building_begin, width, building.count);
+            }
+            else
+            {
+                if (building.count != 0)
+                {
+                    segments.push_back(building);
+                    below += building.count;
+                }
+                reset_top(written, width, 0);
+            }
+        }
+
+        void push_slow(std::int32_t value)
+        {
+            std::size_t const needed = value_width(value);
+            if (end == begin && needed != width) reset_top(begin, needed, 0);
+            else if (needed > width && top_count() <= widen_limit) widen(needed);
+            else if (needed > width) start_segment(needed);
+
+            reserve(end + width);
+            store(end, width, value);
+            end += width;
+            if (end >= repack_at) repack();
+        }
+
+        std::unique_ptr<std::uint8_t[]> bytes;
+        std::size_t capacity = 0;
+        std::size_t end = 0;
+
+        /* the segments below the top one from the bottom up, and the values in them */
+        std::vector<segment_t> segments;
+        std::size_t below = 0;
+
+        /* the top segment, kept out of segments so a push or pop reads nothing else. values from
+         * repack_from on are repacked once end reaches repack_at, and limit is the lower of that
+         * and the capacity */
+        std::size_t begin = 0;
+        std::size_t width = 1;
+        std::uint32_t fit_bias = 0x80;
+        std::uint32_t fit_range = 0xff;
+        std::size_t repack_from = 0;
+        std::size_t repack_at = repack_interval;
+        std::size_t limit = 0;
+    };
+
+    /* the top of stack edits of the decoded engine, for either stack */
+    void replace_back(std::vector<std::int32_t> &stack, std::int32_t value) { stack.back() = value; }
+    void replace_back(compact_stack_t &stack, std::int32_t value) { stack.replace_back(value); }
+    /* breakpoints are trap ops patched into the decoded playfield over the instruction they replace,
+     * so the engine pays for nothing on cells without one. a breakpoint may ask for a minimum stack
+     * depth. watchpoints are checked by p, and they, steps and checkpoints fold into the instruction
+     * count the engine already compares against --max-steps. commands come one per line
+     * from in and every reply is one line on out.
+     *
+     * going backwards restores the nearest checkpoint before the target and runs forward to it. a
+     * checkpoint keeps the stack as the depth it had dropped to since the previous one and the values
+     * above that, the prng and how far a --replay log was read. the input values a run consumed are
+     * kept from the oldest checkpoint on, and after a restore the run takes them from there and prints
+     * nothing until it passes the output it had made, so re-execution repeats the original run exactly */
+    class debugger_t
+    {
+    public:
+        /* where the engine resumes after a restore */
+        struct checkpoint_t
+        {
+            std::uint64_t instructions = 0;
+            std::size_t cell = 0;
+            std::size_t dir = 3;
+
+            /* the lowest depth since the previous checkpoint and what is above it at this one */
+            std::size_t floor = 0;
+            std::vector<std::int32_t> pushed;
+
+            /* the cells p wrote since the previous checkpoint and their values at this one */
+            std::vector<std::pair<std::uint16_t, char>> cells;
+
+            /* the prng once ? drew from it */
+            std::unique_ptr<std::mt19937> prng;
+
+            /* how far the run was into the replayed outcomes, its inputs and outputs */
+            std::size_t randoms = 0;
+            std::size_t inputs = 0;
+            std::size_t outputs = 0;
+        };
+
+        enum class action_t { resume, quit, travel };
+
+        debugger_t(std::FILE *in, std::FILE *out, std::uint64_t interval) : in{in}, out{out}, interval{interval} {}
+
+        /* patches the breakpoints into the program the engine is about to run */
+        void attach(decoded_program_t &decoded)
+        {
+            program = &decoded;
+            for (auto const &entry : breakpoints) arm(entry.first);
+        }
+
+        /* the instruction under a trap, put back while it runs */
+        op_t disarm(std::size_t cell)
+        {
+            auto const found = breakpoints.find(cell);
+            if (found == breakpoints.end()) return program->ops[cell];
+            if (program->ops[cell] == op_t::trap) program->ops[cell] = found->second.op;
+            return found->second.op;
+        }
+
+        void arm(std::size_t cell)
+        {
+            auto const found = breakpoints.find(cell);
+            if (found == breakpoints.end() || program->ops[cell] == op_t::trap) return;
+
+            found->second.op = program->ops[cell];
+            program->ops[cell] = op_t::trap;
+        }
+
+        bool hits(std::size_t cell, std::size_t depth) const
+        {
+            auto const found = breakpoints.find(cell);
+            return found != breakpoints.end() && depth >= found->second.min_depth;
+        }
+
+        bool watched(std::size_t cell) const { return watches[cell] != 0; }
+
+        /* a watchpoint stops before the next instruction like a step would, so the stop looks the same
+         * when a reverse search lands on it. true when the engine should stop there */
+        bool watch_hit(std::string const &reason, std::uint64_t instructions)
+        {
+            if (traveling)
+            {
+                if (searching && instructions < search_end) found.emplace_back(instructions, reason);
+                return false;
+            }
+
+            landing = reason;
+            stop_at = instructions;
+            return true;
+        }
+
+        /* notes a p write for the next checkpoint */
+        void wrote(std::size_t cell)
+        {
+            if (dirty[cell] != 0) return;
+
+            dirty[cell] = 1;
+            dirty_cells.push_back(static_cast<std::uint16_t>(cell));
+        }
+
+        /* the instruction count of the next step stop or checkpoint, whichever comes first */
+        std::uint64_t next_stop() const
+        {
+            std::uint64_t const checkpoint = checkpoints.empty() ? 0 : checkpoints.back().instructions + interval;
+            return std::min(stop_at, checkpoint);
+        }
+
+        bool step_due(std::uint64_t instructions) const { return instructions == stop_at; }
+
+        bool checkpoint_due(std::uint64_t instructions) const
+        {
+            return checkpoints.empty() || instructions == checkpoints.back().instructions + interval;
+        }
+
+        /* saves the state after instructions, where floor is the lowest depth since the previous checkpoint.
+         * with max_checkpoints or more than max_checkpoint_bytes every other one in the older half goes,
+         * and while that is not enough the oldest go */
+        void checkpoint(std::uint64_t instructions, std::size_t cell, std::size_t dir, std::vector<std::int32_t> const &stack, std::size_t floor,
+                        std::array<char, grid_cells> const &data, std::optional<std::mt19937> const &prng, std::size_t randoms)
+        {
+            if (checkpoints.empty()) initial = data;
+
+            checkpoint_t point {instructions, cell, dir, floor, {stack.begin() + floor, stack.end()}, {}, nullptr, randoms, input_cursor, output_cursor};
+            if (prng) point.prng = std::make_unique<std::mt19937>(*prng);
+            for (std::uint16_t const written : dirty_cells)
+            {
+                point.cells.emplace_back(written, data[written]);
+                dirty[written] = 0;
+            }
+            dirty_cells.clear();
+            bytes += size_of(point);
+            checkpoints.push_back(std::move(point));
+
+            if (checkpoints.size() >= max_checkpoints || bytes > max_checkpoint_bytes) thin();
+            while (bytes > max_checkpoint_bytes && checkpoints.size() > 1) drop_oldest();
+        }
+
+        /* the input value the run read at this point before, if it got this far */
+        bool replay_input(std::int32_t &value)
+        {
+            if (input_cursor - input_base == inputs.size()) return false;
+
+            value = inputs[input_cursor++ - input_base];
+            return true;
+        }
+
+        void record_input(std::int32_t value)
+        {
+            inputs.push_back(value);
+            ++input_cursor;
+        }
+
+        /* whether the run printed this output before */
+        bool replay_output()
+        {
+            bool const replayed = output_cursor < outputs;
+            outputs = std::max(outputs, ++output_cursor);
+            return replayed;
+        }
+
+        /* rebuilds the playfield and stack of the checkpoint a travel goes to and rewinds the cursors, the
+         * engine decodes the playfield again and takes the rest from the returned checkpoint */
+        checkpoint_t const &restore(std::array<char, grid_cells> &data, std::vector<std::int32_t> &stack)
+        {
+            checkpoints.resize(destination + 1);
+            bytes = 0;
+            data = initial;
+            stack.clear();
+            for (auto const &point : checkpoints)
+            {
+                for (auto const &[written, value] : point.cells) data[written] = value;
+                stack.resize(point.floor);
+                stack.insert(stack.end(), point.pushed.begin(), point.pushed.end());
+                bytes += size_of(point);
+            }
+            for (std::uint16_t const written : dirty_cells) dirty[written] = 0;
+            dirty_cells.clear();
+
+            checkpoint_t const &point = checkpoints.back();
+            input_cursor = point.inputs;
+            output_cursor = point.outputs;
+            return point;
+        }
+
+        /* reports a stop and serves commands until one resumes the run, quits or travels back */
+        action_t stop(char const *reason, std::size_t cell, std::size_t dir, std::vector<std::int32_t> const &stack,
+                      std::array<char, grid_cells> const &data, std::uint64_t instructions)
+        {
+            bool const stepped = std::string_view{reason} == "step";
+
+            /* a travel runs through the breakpoints on its way, and a search backwards records them
+             * and lands on the last one */
+            if (traveling)
+            {
+                if (!stepped)
+                {
+                    if (searching && instructions < search_end) found.emplace_back(instructions, reason);
+                    return action_t::resume;
+                }
+
+                traveling = false;
+            }
+
+            if (searching)
+            {
+                if (!found.empty())
+                {
+                    searching = false;
+                    landing = found.back().second;
+                    return travel(found.back().first);
+                }
+
+                if (destination == 0)
+                {
+                    searching = false;
+                    landing = checkpoints.front().instructions == 0 ? "start" : "oldest checkpoint";
+                    return travel(0);
+                }
+
+                search_end = checkpoints[destination].instructions;
+                return travel(search_end - 1, true);
+            }
+
+            /* the trap of a cell the run stopped on already does not stop it again */
+            if (std::string_view{reason} == "breakpoint" && last_stop == std::pair{instructions, cell}) return action_t::resume;
+            last_stop = {instructions, cell};
+
+            stop_at = UINT64_MAX;
+            std::fprintf(out, "stopped %s at %zu %zu %s depth %zu after %" PRIu64 " instructions\n", stepped && !landing.empty() ? landing.c_str() : reason,
+                         cell % (max_col_size + 1), cell / (max_col_size + 1), dir_names[dir], stack.size(), instructions);
+            landing.clear();
+
+            std::array<char, 256> line;
+            for (std::fflush(out); std::fgets(line.data(), line.size(), in) != nullptr; std::fflush(out))
+            {
+                std::array<char, 24> command = {};
+                long x = 0, y = 0;
+                unsigned long long count = 0;
+                int const fields = std::sscanf(line.data(), "%23s %ld %ld %llu", command.data(), &x, &y, &count);
+                std::string_view const name = fields > 0 ? command.data() : "";
+                bool const in_bounds = fields >= 3 && x >= 0 && x < static_cast<long>(max_col_size) && y >= 0 && y < static_cast<long>(max_row_size);
+                std::size_t const target = in_bounds ? static_cast<std::size_t>(y) * (max_col_size + 1) + static_cast<std::size_t>(x) : 0;
+                std::uint64_t const repeat = fields >= 2 && x > 0 ? static_cast<std::uint64_t>(x) : 1;
+
+                if (name == "continue" || name == "c") return action_t::resume;
+
+                if (name == "step" || name == "s")
+                {
+                    stop_at = instructions + repeat;
+                    return action_t::resume;
+                }
+
+                if (name == "quit" || name == "q") return action_t::quit;
+
+                if ((name == "reverse-step" || name == "rs" || name == "reverse-continue" || name == "rc") && instructions == 0)
+                {
+                    std::fprintf(out, "error at the first instruction\n");
+                }
+                else if ((name == "reverse-step" || name == "rs" || name == "reverse-continue" || name == "rc") &&
+                         instructions <= checkpoints.front().instructions)
+                {
+                    std::fprintf(out, "error at the oldest checkpoint\n");
+                }
+                else if (name == "reverse-step" || name == "rs")
+                {
+                    landing = "reverse-step";
+                    return travel(instructions > repeat ? instructions - repeat : 0);
+                }
+                else if (name == "reverse-continue" || name == "rc")
+                {
+                    searching = true;
+                    search_end = instructions;
+                    return travel(instructions - 1, true);
+                }
+                else if (name == "where")
+                {
+                    std::fprintf(out, "at %zu %zu %s depth %zu after %" PRIu64 " instructions\n", cell % (max_col_size + 1),
+                                 cell / (max_col_size + 1), dir_names[dir], stack.size(), instructions);
+                }
+                else if (name == "stack")
+                {
+                    std::fprintf(out, "stack");
+                    for (std::int32_t const value : stack) std::fprintf(out, " %" PRId32, value);
+                    std::fprintf(out, "\n");
+                }
+                else if (name == "checkpoints")
+                {
+                    std::fprintf(out, "checkpoints %zu", checkpoints.size());
+                    for (auto const &point : checkpoints) std::fprintf(out, " %" PRIu64, point.instructions);
+                    std::fprintf(out, "\n");
+                }
+                else if ((name == "break" || name == "delete" || name == "watch" || name == "unwatch" || name == "get") && !in_bounds)
+                {
+                    std::fprintf(out, "error expected a cell inside 80x25\n");
+                }
+                else if (name == "break")
+                {
+                    auto &breakpoint = breakpoints[target];
+                    breakpoint.min_depth = fields >= 4 ? count : 0;
+                    if (program != nullptr && target != cell) arm(target);
+                    std::fprintf(out, "ok\n");
+                }
+                else if (name == "delete")
+                {
+                    if (program != nullptr) disarm(target);
+                    breakpoints.erase(target);
+                    std::fprintf(out, "ok\n");
+                }
+                else if (name == "watch" || name == "unwatch")
+                {
+                    watches[target] = name == "watch";
+                    std::fprintf(out, "ok\n");
+                }
+                else if (name == "get")
+                {
+                    std::fprintf(out, "cell %ld %ld %d\n", x, y, data[target]);
+                }
+                else
+                {
+                    std::fprintf(out, "error unknown command\n");
+                }
+            }
+
+            return action_t::quit;
+        }
+
+        void finish(char const *how, std::uint64_t instructions)
+        {
+            std::fprintf(out, "%s after %" PRIu64 " instructions\n", how, instructions);
+            std::fflush(out);
+        }
+
+    private:
+        static constexpr std::size_t max_checkpoints = 1024;
+        static constexpr std::size_t max_checkpoint_bytes = std::size_t{64} << 20;
+
+        static std::size_t size_of(checkpoint_t const &point)
+        {
+            return sizeof point + point.pushed.size() * sizeof point.pushed[0] + point.cells.size() * sizeof point.cells[0] +
+                   (point.prng ? sizeof *point.prng : 0);
+        }
+
+        /* drops every other checkpoint in the older half */
+        void thin()
+        {
+            std::vector<checkpoint_t> kept;
+            for (std::size_t i = 0; i < checkpoints.size(); ++i)
+            {
+                if (i % 2 == 0 || i >= checkpoints.size() / 2)
+                {
+                    kept.push_back(std::move(checkpoints[i]));
+                    continue;
+                }
+
+                merge(checkpoints[i], checkpoints[i + 1]);
+            }
+            checkpoints = std::move(kept);
+
+            bytes = 0;
+            for (auto const &point : checkpoints) bytes += size_of(point);
+        }
+
+        /* folds the oldest checkpoint into the playfield everything starts from and into the next one,
+         * then forgets the inputs read before the new oldest */
+        void drop_oldest()
+        {
+            checkpoint_t &oldest = checkpoints.front();
+            for (auto const &[written, value] : oldest.cells) initial[written] = value;
+            oldest.cells.clear();
+            bytes -= size_of(oldest) + size_of(checkpoints[1]);
+            merge(oldest, checkpoints[1]);
+            bytes += size_of(checkpoints[1]);
+            checkpoints.erase(checkpoints.begin());
+
+            std::size_t const first = checkpoints.front().inputs;
+            inputs.erase(inputs.begin(), inputs.begin() + static_cast<std::ptrdiff_t>(first - input_base));
+            input_base = first;
+        }
+
+        /* hands a dropped checkpoint to the next one, which keeps its own values of the cells both wrote
+         * and takes the values the dropped one pushed below its floor */
+        static void merge(checkpoint_t &dropped, checkpoint_t &later)
+        {
+            for (auto const &entry : dropped.cells)
+            {
+                bool const overwritten = std::any_of(later.cells.begin(), later.cells.end(), [&](auto const &other) { return other.first == entry.first; });
+                if (!overwritten) later.cells.push_back(entry);
+            }
+
+            if (later.floor < dropped.floor) return;
+
+            dropped.pushed.resize(later.floor - dropped.floor);
+            dropped.pushed.insert(dropped.pushed.end(), later.pushed.begin(), later.pushed.end());
+            later.pushed = std::move(dropped.pushed);
+            later.floor = dropped.floor;
+        }
+
+        struct breakpoint_t
+        {
+            op_t op = op_t::nop;
+            std::size_t min_depth = 0;
+        };
+
+        /* picks the last checkpoint at or before target and runs up to it, or with search up to
+         * search_end while collecting the stops in between. a target before the oldest checkpoint
+         * lands on it */
+        action_t travel(std::uint64_t target, bool search = false)
+        {
+            destination = 0;
+            while (destination + 1 < checkpoints.size() && checkpoints[destination + 1].instructions <= target) ++destination;
+
+            if (search) found.clear();
+            stop_at = search ? search_end : std::max(target, checkpoints.front().instructions);
+            traveling = true;
+            last_stop = {UINT64_MAX, 0};
+            return action_t::travel;
+        }
+
+        std::FILE *in;
+        std::FILE *out;
+        decoded_program_t *program = nullptr;
+        std::unordered_map<std::size_t, breakpoint_t> breakpoints;
+        std::array<std::uint8_t, grid_cells> watches = {};
+        std::uint64_t stop_at = UINT64_MAX;
+        std::pair<std::uint64_t, std::size_t> last_stop {UINT64_MAX, 0};
+
+        std::uint64_t interval;
+        std::array<char, grid_cells> initial = {};
+        std::vector<checkpoint_t> checkpoints;
+        std::size_t bytes = 0;
+        std::array<std::uint8_t, grid_cells> dirty = {};
+        std::vector<std::uint16_t> dirty_cells;
+
+        /* the inputs from the oldest checkpoint on, the first of them being input number input_base */
+        std::vector<std::int32_t> inputs;
+        std::size_t input_base = 0;
+        std::size_t outputs = 0;
+        std::size_t input_cursor = 0;
+        std::size_t output_cursor = 0;
+
+        /* the checkpoint a travel restores, and the reason the stop it lands on reports */
+        std::size_t destination = 0;
+        std::string landing;
+        bool traveling = false;
+        bool searching = false;
+        std::uint64_t search_end = 0;
+        std::vector<std::pair<std::uint64_t, std::string>> found;
+    };
+
+    void swap_back(std::vector<std::int32_t> &stack) { std::swap(stack.end()[-1], stack.end()[-2]); }
+    void swap_back(compact_stack_t &stack) { stack.swap_back(); }
+    std::vector<std::int32_t> stack_values(std::vector<std::int32_t> const &stack) { return stack; }
+    std::vector<std::int32_t> stack_values(compact_stack_t const &stack) { return stack.values(); }
+    std::size_t stack_bytes(std::vector<std::int32_t> const &stack) { return stack.capacity() * sizeof(std::int32_t); }
+    std::size_t stack_bytes(compact_stack_t const &stack) { return stack.allocated(); }
+}
+
+/* runs the program from a decoded copy of the playfield, p decodes the cell it writes again. it
+ * behaves like interpret() but observes nothing beyond hook_count, which also counts p writes per cell
+ * when stats tracks cells, and hook_debug. Stack is std::vector<std::int32_t>
+ * for the decoded engine and compact_stack_t for the compact one */
+template <unsigned Hooks, typename Stack = std::vector<std::int32_t>>
+bool interpret_decoded(grid_t grid, options_t const &options, stats_t &stats, event_log_t &events)
+{
+    static_assert((Hooks & ~unsigned{hook_count | hook_debug}) == 0, "the decoded engine only counts and debugs");
+    static_assert((Hooks & hook_debug) == 0 || (Hooks & hook_count) != 0, "steps need the instruction count");
+
+    auto &data = grid.data;
+    bool const extensions = options.extensions;
+    std::uint64_t const max_steps = options.max_steps;
+
+    /* max_steps, or the step a debugger asked to stop at when that comes first */
+    std::uint64_t limit = max_steps;
+
+    std::unique_ptr<decoded_program_t> const program = std::make_unique<decoded_program_t>();
+    decode(grid, extensions, *program);
+    auto &[ops, values, next] = *program;
+
+    Stack stack;
+
+    /* the lowest depth since the last checkpoint, which only a debugger keeps */
+    std::size_t floor = 0;
+    auto lower = [&](std::size_t depth)
+    {
+        if constexpr ((Hooks & hook_debug) != 0) floor = std::min(floor, depth);
+    };
+
+    auto pop = [&]() -> std::int32_t
+    {
+        if (stack.empty()) return 0;
+
+        std::int32_t const temp = stack.back();
+        stack.pop_back();
+        lower(stack.size());
+        return temp;
+    };
+    on_exit_t const save_final_state {[&] { if (options.final_state != nullptr) *options.final_state = {stack_values(stack), data}; }};
+    on_exit_t const save_stack_bytes {[&] { if constexpr ((Hooks & hook_count) != 0) stats.stack_bytes = stack_bytes(stack); }};
+
+    /* the cell and the index of the direction in next */
+    std::size_t cell = 0, dir = 3;
+
+    lazy_prng_t prng {options};
+
+    /* a breakpoint whose trap comes back once its instruction ran, grid_cells for none, and whether
+     * the last stop restored a checkpoint, which leaves the instruction it stopped in unfinished */
+    std::size_t rearm = grid_cells;
+    bool traveled = false;
+    auto stop = [&](char const *reason)
+    {
+        auto const action = options.debugger->stop(reason, cell, dir, stack_values(stack), data, stats.instructions);
+        if constexpr ((Hooks & hook_debug) != 0)
+        {
+            if (action == debugger_t::action_t::travel)
+            {
+                auto const &point = options.debugger->restore(data, stack);
+                decode(grid, extensions, *program);
+                options.debugger->attach(*program);
+                prng.restore(point.prng.get());
+                events.seek_random(point.randoms);
+                floor = stack.size();
+                cell = point.cell;
+                dir = point.dir;
+                stats.instructions = point.instructions;
+                traveled = true;
+            }
+        }
+        limit = std::min(max_steps, options.debugger->next_stop());
+        rearm = cell;
+        return action != debugger_t::action_t::quit;
+    };
+    if constexpr ((Hooks & hook_debug) != 0)
+    {
+        options.debugger->attach(*program);
+        options.debugger->checkpoint(0, cell, dir, stack, 0, data, prng.state(), 0);
+        if (!stop("start")) return false;
+    }
+
+    for (;;)
+    {
+        if constexpr ((Hooks & hook_count) != 0)
+        {
+            if (stats.instructions == limit)
+            {
+                if constexpr ((Hooks & hook_debug) == 0) return false;
+                else
+                {
+                    if (options.debugger->checkpoint_due(stats.instructions))
+                    {
+                        options.debugger->checkpoint(stats.instructions, cell, dir, stack, floor, data, prng.state(), events.random_position());
+                        floor = stack.size();
+                    }
+                    if (options.debugger->step_due(stats.instructions))
+                    {
+                        if (!stop("step")) return false;
+                        if (std::exchange(traveled, false)) continue;
+                    }
+                    if (stats.instructions == max_steps) return false;
+                    limit = std::min(max_steps, options.debugger->next_stop());
+                }
+            }
+            ++stats.instructions;
+        }
+
+        switch (ops[cell])
+        {
+            case op_t::nop: break;
+
+            case op_t::add:
+            {
+                stack.push_back(pop() + pop());
+            } break;
+
+            case op_t::subtract:
+            {
+                std::int32_t const a = pop();
+                std::int32_t const b = pop();
+                stack.push_back(b - a);
+            } break;
+
+            case op_t::divide:
+            {
+                std::int32_t const a = pop();
+                std::int32_t const b = pop();
+                stack.push_back(divide(b, a));
+            } break;
+
+            case op_t::multiply:
+            {
+                stack.push_back(pop() * pop());
+            } break;
+
+            case op_t::modulo:
+            {
+                std::int32_t const a = pop();
+                std::int32_t const b = pop();
+                stack.push_back(modulo(b, a));
+            } break;
+
+            case op_t::logical_not:
+            {
+                if (stack.empty()) stack.push_back(1);
+                else
+                {
+                    lower(stack.size() - 1);
+                    replace_back(stack, stack.back() == 0);
+                }
+            } break;
+
+            case op_t::greater:
+            {
+                std::int32_t const a = pop();
+                std::int32_t const b = pop();
+                stack.push_back(b > a);
+            } break;
+
+            case op_t::south: dir = 0; break;
+            case op_t::north: dir = 1; break;
+            case op_t::west: dir = 2; break;
+            case op_t::east: dir = 3; break;
+
+            case op_t::horizontal_if:
+            {
+                dir = pop() != 0 ? 2 : 3;
+            } break;
+
+            case op_t::vertical_if:
+            {
+                dir = pop() != 0 ? 1 : 0;
+            } break;
+
+            case op_t::string_mode:
+            {
+                for (cell = next[cell][dir]; data[cell] != '"'; cell = next[cell][dir]) stack.push_back(data[cell]);
+            } break;
+
+            case op_t::duplicate:
+            {
+                stack.push_back(stack.empty() ? 0 : stack.back());
+            } break;
+
+            case op_t::swap:
+            {
+                if (stack.size() >= 2)
+                {
+                    lower(stack.size() - 2);
+                    swap_back(stack);
+                }
+                else if (stack.size() == 1) stack.push_back(0);
+            } break;
+
+            case op_t::discard:
+            {
+                pop();
+            } break;
+
+            case op_t::output_int:
+            {
+                std::int32_t const value = pop();
+                if constexpr ((Hooks & hook_debug) != 0)
+                {
+                    if (options.debugger->replay_output()) break;
+                }
+
+                int const written = std::printf("%" PRId32 " ", value);
+                if constexpr ((Hooks & hook_count) != 0) stats.bytes_out += written > 0 ? written : 0;
+            } break;
+
+            case op_t::output_char:
+            {
+                std::int32_t const value = pop();
+                if constexpr ((Hooks & hook_debug) != 0)
+                {
+                    if (options.debugger->replay_output()) break;
+                }
+
+                std::putchar(static_cast<char>(value));
+                if constexpr ((Hooks & hook_count) != 0) ++stats.bytes_out;
+            } break;
+
+            case op_t::bridge:
+            {
+                cell = next[cell][dir];
+            } break;
+
+            case op_t::get:
+            {
+                std::ptrdiff_t const y = pop();
+                std::ptrdiff_t const x = pop();
+                bool const in_bounds = x >= 0 && x < static_cast<std::ptrdiff_t>(max_col_size) &&
+                                       y >= 0 && y < static_cast<std::ptrdiff_t>(max_row_size);
+                stack.push_back(in_bounds ? data[y * grid.cols + x] : 0);
+            } break;
+
+            case op_t::put:
+            {
+                std::ptrdiff_t const y = pop();
+                std::ptrdiff_t const x = pop();
+                std::int32_t const value = pop();
+                if (x >= 0 && x < static_cast<std::ptrdiff_t>(max_col_size) &&
+                    y >= 0 && y < static_cast<std::ptrdiff_t>(max_row_size))
+                {
+                    std::size_t const target = y * grid.cols + x;
+                    data[target] = truncate(value);
+                    ops[target] = decode_cell(data[target], extensions, values[target]);
+                    if constexpr ((Hooks & hook_count) != 0)
+                    {
+                        if (!stats.writes.empty()) ++stats.writes[target];
+                    }
+                    if constexpr ((Hooks & hook_debug) != 0)
+                    {
+                        options.debugger->arm(target);
+                        options.debugger->wrote(target);
+                        if (options.debugger->watched(target))
+                        {
+                            std::string const reason = "watch " + std::to_string(x) + ' ' + std::to_string(y) + " = " + std::to_string(data[target]);
+                            if (options.debugger->watch_hit(reason, stats.instructions)) limit = stats.instructions;
+                        }
+                    }
+                }
+            } break;
+
+            case op_t::input_int:
+            {
+                std::int32_t value = -1;
+                if constexpr ((Hooks & hook_debug) != 0)
+                {
+                    if (options.debugger->replay_input(value))
+                    {
+                        stack.push_back(value);
+                        break;
+                    }
+                }
+
+                if (!read_input<Hooks>('&', events, stats, value)) return false;
+                if constexpr ((Hooks & hook_debug) != 0) options.debugger->record_input(value);
+                stack.push_back(value);
+            } break;
+
+            case op_t::input_char:
+            {
+                std::int32_t value = -1;
+                if constexpr ((Hooks & hook_debug) != 0)
+                {
+                    if (options.debugger->replay_input(value))
+                    {
+                        stack.push_back(value);
+                        break;
+                    }
+                }
+
+                if (!read_input<Hooks>('~', events, stats, value)) return false;
+                if constexpr ((Hooks & hook_debug) != 0) options.debugger->record_input(value);
+                stack.push_back(value);
+            } break;
+
+            case op_t::end: return true;
+
+            case op_t::push:
+            {
+                stack.push_back(values[cell]);
+            } break;
+
+            case op_t::random:
+            {
+                std::size_t draw;
+
+                if (events.mode == event_log_t::mode_t::replay)
+                {
+                    if (!events.replay_random(draw)) return false;
+                }
+                else
+                {
+                    draw = prng.draw();
+                    if (events.mode == event_log_t::mode_t::record) events.record_random(draw);
+                }
+                dir = draw;
+            } break;
+
+            case op_t::fetch:
+            {
+                cell = next[cell][dir];
+                stack.push_back(data[cell]);
+            } break;
+
+            /* runs the instruction under the trap in the next round, without counting the trap */
+            case op_t::trap:
+            {
+                if constexpr ((Hooks & hook_debug) != 0)
+                {
+                    --stats.instructions;
+                    options.debugger->disarm(cell);
+                    rearm = cell;
+                    if (options.debugger->hits(cell, stack.size()) && !stop("breakpoint")) return false;
+                    traveled = false;
+                    continue;
+                }
+            } break;
+        }
+
+        if constexpr ((Hooks & hook_debug) != 0)
+        {
+            if (rearm != grid_cells)
+            {
+                options.debugger->arm(rearm);
+                rearm = grid_cells;
+            }
+        }
+
+        cell = next[cell][dir];
+    }
+}
+
+namespace
+{
+    /* calls the interpret() instantiation matching a runtime hook mask */
+    template <unsigned Hooks = 0>
+    bool interpret_hooked(unsigned hooks, grid_t const &grid, options_t const &options, stats_t &stats, event_log_t &events)
+    {
+        if constexpr (Hooks <= hook_all)
+        {
+            if constexpr (valid_hooks(Hooks))
+            {
+                if (hooks == Hooks) return interpret<Hooks>(grid, options, stats, events);
+            }
+            return interpret_hooked<Hooks + 1>(hooks, grid, options, stats, events);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    /* the decoded engines only count, run() keeps other hooks away from them */
+    bool run_engine(std::size_t engine, unsigned hooks, grid_t const &grid, options_t const &options, stats_t &stats, event_log_t &events)
+    {
+        if (engine == engine_decoded)
+        {
+            return hooks != 0 ? interpret_decoded<hook_count>(grid, options, stats, events)
+                              : interpret_decoded<0>(grid, options, stats, events);
+        }
+
+        if (engine == engine_compact)
+        {
+            return hooks != 0 ? interpret_decoded<hook_count, compact_stack_t>(grid, options, stats, events)
+                              : interpret_decoded<0, compact_stack_t>(grid, options, stats, events);
+        }
+
+        return interpret_hooked(hooks, grid, options, stats, events);
+    }
+
+    /* returns false when the program did not run to completion */
+    bool run(std::string_view filepath, options_t const &options)
+    {
+        trace_span_t const job_span{"job", "batch", std::string{filepath}};
+        perf_group_t perf{options.perf_counters};
+        grid_t const grid = [&]
+        {
+            trace_span_t const span{"load", "phase", std::string{filepath}};
+            return readfile(filepath);
+        }();
+        perf.phase("load");
+
+        unsigned hooks = 0;
+        if (!options.heatmap.empty() || options.smc_report || !options.smc_hints.empty()) hooks |= hook_count | hook_stats;
+
+        /* the decoded engines report what hook_count keeps, the instructions and bytes in and out */
+        if (options.stats) hooks |= options.engine == engine_switch ? hook_count | hook_stats : hook_count;
+        if (options.perf_counters) hooks |= hook_count;
+        if (options.sample_hz > 0) hooks |= hook_probe;
+        if (!options.telemetry_shm.empty()) hooks |= hook_count | hook_telemetry;
+        if (options.max_steps != UINT64_MAX) hooks |= hook_count;
+        if (options.flight_recorder > 0) hooks |= hook_flight;
+        if (options.engine != engine_switch && (hooks & ~unsigned{hook_count}) != 0)
+        {
+            std::fprintf(stderr, "Error: the %s engine supports no profiling or reports besides --stats, --perf-counters and --max-steps\n",
+                         tier_names[options.engine]);
+            return false;
+        }
+        if (options.flight_recorder > 0) arm_flight_recorder(options.flight_recorder);
+
+        std::unique_ptr<stats_t> const stats = std::make_unique<stats_t>();
+        if ((hooks & hook_stats) != 0) stats->track_cells();
+        event_log_t events;
+        if (!options.record.empty()) events.mode = event_log_t::mode_t::record;
+        if (!options.replay.empty())
+        {
+            events.mode = event_log_t::mode_t::replay;
+            if (!events.load(std::string{options.replay}))
+            {
+                std::fprintf(stderr, "Error: could not load replay log %.*s\n",
+                             static_cast<int>(options.replay.size()), options.replay.data());
+                return false;
+            }
+        }
+
+        std::unique_ptr<telemetry_shm_t> const shm = options.telemetry_shm.empty() ? nullptr : std::make_unique<telemetry_shm_t>(options.telemetry_shm);
+        std::unique_ptr<sampler_t> const sampler = options.sample_hz > 0 ? std::make_unique<sampler_t>(options.sample_hz) : nullptr;
+        auto const wall_start = std::chrono::steady_clock::now();
+        /* cpu time is only reported with the stats, and reading it can cost more than a small program */
+        std::clock_t const cpu_start = options.stats ? std::clock() : 0;
+        perf.phase("setup");
+
+        bool completed;
+        {
+            trace_span_t const span{"execute", "tier", tier_names[options.engine]};
+            completed = run_engine(options.engine, hooks, grid, options, *stats, events);
+        }
+        perf.phase("execution");
+
+        std::clock_t const cpu_end = options.stats ? std::clock() : 0;
+        auto const wall_end = std::chrono::steady_clock::now();
+
+        if (sampler) sampler->stop();
+
+        /* keep the reports after everything the program printed */
+        {
+            trace_span_t const span{"output flush", "io"};
+            std::fflush(stdout);
+        }
+        perf.phase("output flush");
+
+        if (options.stats)
+        {
+            print_stats_json(stderr, *stats,
+                             std::chrono::duration<double>(wall_end - wall_start).count(),
+                             static_cast<double>(cpu_end - cpu_start) / CLOCKS_PER_SEC);
+        }
+
+        if (!options.heatmap.empty())
+        {
+            write_heatmap(options.heatmap, grid, *stats);
+        }
+
+        if (options.smc_report)
+        {
+            print_smc_report(stderr, grid, *stats);
+        }
+
+        if (!options.smc_hints.empty())
+        {
+            write_smc_hints(options.smc_hints, grid, *stats);
+        }
+
+        if (sampler)
+        {
+            report_sample_profile(sampler->profile, sample_ring.dropped.load(), grid);
+        }
+
+        perf.report(stderr, "execution", stats->instructions);
+
+        if (!options.record.empty() && !events.save(std::string{options.record}))
+        {
+            std::fprintf(stderr, "Error: could not write %.*s\n", static_cast<int>(options.record.size()), options.record.data());
+            completed = false;
+        }
+
+        if (events.exhausted)
+        {
+            std::fprintf(stderr, "Error: replay log %.*s ran out of events\n",
+                         static_cast<int>(options.replay.size()), options.replay.data());
+        }
+        else if (!completed && stats->instructions == options.max_steps)
+        {
+            std::fprintf(stderr, "Error: step budget of %" PRIu64 " exhausted\n", options.max_steps);
+            if (options.flight_recorder > 0) dump_flight_recorder(0);
+        }
+        flight.grid.store(nullptr);
+
+        return completed;
+    }
+
+    /* what a child running one engine reports back */
+    struct engine_result_t
+    {
+        double seconds;
+        std::uint64_t instructions;
+        std::size_t stack_bytes;
+        bool completed;
+    };
+
+    std::string read_all(int fd)
+    {
+        std::string result;
+        std::array<char, 4096> buffer;
+        for (off_t offset = 0;;)
+        {
+            ssize_t const got = pread(fd, buffer.data(), buffer.size(), offset);
+            if (got <= 0) return result;
+            result.append(buffer.data(), static_cast<std::size_t>(got));
+            offset += got;
+        }
+    }
+
+    /* runs the program on every engine, each in a child so a crash or stray output stays with it. the
+     * first run records stdin and the ? outcomes, every engine replays them, so they all do the same
+     * work. prints the best of compare_runs runs per engine and the bytes its stack allocated, since
+     * the children's rss is mostly the pages they share, and returns false when an output differs */
+    bool compare_engines(std::string_view filepath, options_t const &options)
+    {
+        constexpr std::size_t compare_runs = 5;
+        grid_t const grid = readfile(filepath);
+
+        std::FILE *const reference = std::tmpfile();
+        if (reference == nullptr)
+        {
+            std::fprintf(stderr, "Error: could not create a temporary file\n");
+            return false;
+        }
+
+        /* the recording run writes the reference output */
+        event_log_t events;
+        events.mode = event_log_t::mode_t::record;
+        std::unique_ptr<stats_t> const stats = std::make_unique<stats_t>();
+        std::fflush(stdout);
+        int const saved_stdout = dup(STDOUT_FILENO);
+        dup2(fileno(reference), STDOUT_FILENO);
+        interpret<hook_count>(grid, options, *stats, events);
+        std::fflush(stdout);
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+        events.rewind();
+
+        std::string const expected = read_all(fileno(reference));
+        std::fclose(reference);
+
+        std::printf("%-10s %12s %9s %12s %12s %14s  %s\n", "engine", "runtime_ms", "speedup", "stack_bytes", "compile_ms", "instructions", "output");
+        bool identical = true;
+        double switch_seconds = 0;
+        for (std::size_t engine = 0; engine < tier_names.size(); ++engine)
+        {
+            std::FILE *const output = std::tmpfile();
+            int channel[2];
+            if (output == nullptr || pipe(channel) != 0)
+            {
+                std::fprintf(stderr, "Error: could not set up the %s engine\n", tier_names[engine]);
+                return false;
+            }
+
+            std::fflush(stdout);
+            pid_t const child = fork();
+            if (child == 0)
+            {
+                close(channel[0]);
+                int const null = open("/dev/null", O_RDWR);
+                dup2(null, STDIN_FILENO);
+
+                engine_result_t result = {std::numeric_limits<double>::infinity(), 0, 0, false};
+                for (std::size_t i = 0; i < compare_runs; ++i)
+                {
+                    /* only the first run's output is compared */
+                    dup2(i == 0 ? fileno(output) : null, STDOUT_FILENO);
+
+                    event_log_t replay = events;
+                    stats_t &counts = *stats;
+                    counts.instructions = counts.bytes_in = counts.bytes_out = counts.stack_bytes = 0;
+                    auto const start = std::chrono::steady_clock::now();
+                    bool const completed = run_engine(engine, hook_count, grid, options, counts, replay);
+                    std::fflush(stdout);
+                    double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                    result = {std::min(result.seconds, elapsed), counts.instructions, counts.stack_bytes, completed};
+                }
+
+                ssize_t const written = write(channel[1], &result, sizeof(result));
+                _exit(written == sizeof(result) ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+
+            close(channel[1]);
+            engine_result_t result = {};
+            bool const reported = child > 0 && read(channel[0], &result, sizeof(result)) == sizeof(result);
+            close(channel[0]);
+
+            int status = 0;
+            if (child > 0) waitpid(child, &status, 0);
+
+            std::string const got = read_all(fileno(output));
+            std::fclose(output);
+            if (!reported)
+            {
+                std::fprintf(stderr, "Error: the %s engine did not report\n", tier_names[engine]);
+                return false;
+            }
+
+            /* the time to decode the playfield, engines without a compile step have none */
+            char compile[32] = "-";
+            if (engine != engine_switch)
+            {
+                std::unique_ptr<decoded_program_t> const program = std::make_unique<decoded_program_t>();
+                double best = std::numeric_limits<double>::infinity();
+                for (std::size_t i = 0; i < compare_runs; ++i)
+                {
+                    auto const start = std::chrono::steady_clock::now();
+                    decode(grid, options.extensions, *program);
+                    best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+                }
+                std::snprintf(compile, sizeof(compile), "%.4f", best * 1e3);
+            }
+
+            if (engine == engine_switch) switch_seconds = result.seconds;
+            bool const same = got == expected;
+            identical &= same;
+            std::printf("%-10s %12.4f %8.2fx %12zu %12s %14" PRIu64 "  %s\n", tier_names[engine], result.seconds * 1e3,
+                        result.seconds > 0 ? switch_seconds / result.seconds : 0, result.stack_bytes, compile,
+                        result.instructions, engine == engine_switch ? (same ? "reference" : "differs from the recording run")
+                                                                     : same ? "identical" : "differs");
+        }
+
+        if (!identical)
+        {
+            std::fprintf(stderr, "Error: the engines disagree on the output of %.*s\n", static_cast<int>(filepath.size()), filepath.data());
+        }
+
+        return identical;
+    }
+
+    /* loads the program once and times options.repeat runs of it in process. a first untimed run
+     * records the input and the ? outcomes (or the --replay log stands in for it), the timed runs
+     * replay them, each from a fresh copy of the loaded grid, with stdout going to options.sink (- keeps
+     * stdout). without --seed the recording run draws from seed 0, so repeated invocations agree */
+    bool repeat(std::string_view filepath, options_t options)
+    {
+        grid_t const grid = readfile(filepath);
+        unsigned const hooks = options.max_steps != UINT64_MAX ? unsigned{hook_count} : 0u;
+        options.seeded = true;
+
+        int const sink = options.sink == "-" ? dup(STDOUT_FILENO) : open(std::string{options.sink}.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (sink < 0)
+        {
+            std::fprintf(stderr, "Error: could not open %.*s\n", static_cast<int>(options.sink.size()), options.sink.data());
+            return false;
+        }
+
+        /* the recording run prints nothing */
+        std::fflush(stdout);
+        int const saved_stdout = dup(STDOUT_FILENO);
+        int const null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        close(null);
+
+        std::unique_ptr<stats_t> const stats = std::make_unique<stats_t>();
+        event_log_t events;
+        bool ok = true;
+        if (!options.replay.empty())
+        {
+            ok = events.load(std::string{options.replay});
+        }
+        else
+        {
+            events.mode = event_log_t::mode_t::record;
+            run_engine(options.engine, hooks, grid, options, *stats, events);
+            if (!options.record.empty()) ok = events.save(std::string{options.record});
+            events.rewind();
+        }
+
+        std::fflush(stdout);
+        dup2(sink, STDOUT_FILENO);
+        close(sink);
+
+        std::vector<double> seconds;
+        bool completed = true;
+        for (std::size_t i = 0; ok && i < options.repeat; ++i)
+        {
+            event_log_t replay = events;
+            replay.mode = event_log_t::mode_t::replay;
+            stats->instructions = stats->bytes_in = stats->bytes_out = 0;
+
+            auto const start = std::chrono::steady_clock::now();
+            completed &= run_engine(options.engine, hooks, grid, options, *stats, replay);
+            std::fflush(stdout);
+            seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+        if (!ok)
+        {
+            std::fprintf(stderr, "Error: could not %s the event log\n", options.replay.empty() ? "write" : "load");
+            return false;
+        }
+
+        std::sort(seconds.begin(), seconds.end());
+        auto const rank = [&](double fraction)
+        {
+            std::size_t const index = static_cast<std::size_t>(std::ceil(fraction * static_cast<double>(seconds.size())));
+            return seconds[std::clamp<std::size_t>(index, 1, seconds.size()) - 1];
+        };
+
+        std::fprintf(stderr, "%zu runs of %.*s on %s: min %.3f us, median %.3f us, p99 %.3f us, max %.3f us\n",
+                     seconds.size(), static_cast<int>(filepath.size()), filepath.data(), tier_names[options.engine],
+                     seconds.front() * 1e6, rank(0.5) * 1e6, rank(0.99) * 1e6, seconds.back() * 1e6);
+
+        /* ten equal buckets from the fastest to the slowest run, bars scaled to the fullest */
+        constexpr std::size_t buckets = 10, bar_width = 50;
+        std::array<std::size_t, buckets> counts = {};
+        double const width = (seconds.back() - seconds.front()) / buckets;
+        for (double run_seconds : seconds)
+        {
+            std::size_t const bucket = width > 0 ? static_cast<std::size_t>((run_seconds - seconds.front()) / width) : 0;
+            ++counts[std::min(bucket, buckets - 1)];
+        }
+
+        std::size_t const fullest = *std::max_element(counts.begin(), counts.end());
+        for (std::size_t bucket = 0; bucket < buckets; ++bucket)
+        {
+            double const from = seconds.front() + width * static_cast<double>(bucket);
+            std::fprintf(stderr, "%12.3f us %8zu |%s\n", from * 1e6, counts[bucket],
+                         std::string(counts[bucket] * bar_width / fullest, '#').c_str());
+            if (width == 0) break;
+        }
+
+        if (!completed) std::fprintf(stderr, "Error: a run did not finish\n");
+        return completed;
+    }
+
+    /* the control flow graph of the initial playfield over (cell, direction) states, a state being a
+     * cell and the direction the cursor arrived in like the heatmap counts them. a block follows the
+     * cursor through arrows and ends at _, | and ?, at @, at # and at a wrap around an edge (which
+     * get edges of their own) and before a state that more than one path reaches */
+    struct cfg_block_t
+    {
+        std::vector<std::uint16_t> states;
+        std::string code;
+        std::size_t instructions = 0;
+
+        /* the stack depth the block consumes from its entry stack, and the depth it leaves */
+        std::size_t stack_in = 0;
+        std::size_t stack_out = 0;
+
+        /* a p with constant coordinates writes one of its cells, or some p has coordinates that are
+         * only known at runtime */
+        bool written = false;
+    };
+
+    struct cfg_edge_t
+    {
+        std::size_t from;
+        std::size_t to;
+        char const *kind;
+    };
+
+    struct cfg_t
+    {
+        std::vector<cfg_block_t> blocks;
+        std::vector<cfg_edge_t> edges;
+        bool unknown_puts = false;
+    };
+
+    constexpr std::uint16_t cfg_state(std::size_t cell, std::size_t dir)
+    {
+        return static_cast<std::uint16_t>(cell * 4 + dir);
+    }
+
+    /* the next cell in a direction, wrapping like the cursor does */
+    std::size_t cfg_advance(grid_t const &grid, std::size_t cell, std::size_t dir)
+    {
+        std::array<std::array<std::size_t, 2>, 4> const steps {{{0, 1}, {0, grid.rows - 1}, {grid.cols - 1, 0}, {1, 0}}};
+        std::size_t const x = (cell % grid.cols + steps[dir][0]) % grid.cols;
+        std::size_t const y = (cell / grid.cols + steps[dir][1]) % grid.rows;
+        return y * grid.cols + x;
+    }
+
+    /* the characters a string literal starting at cell pushes */
+    std::string cfg_literal(grid_t const &grid, std::size_t cell, std::size_t dir)
+    {
+        std::string text;
+        for (cell = cfg_advance(grid, cell, dir); grid.data[cell] != '"'; cell = cfg_advance(grid, cell, dir)) text += grid.data[cell];
+        return text;
+    }
+
+    /* where the cursor goes from a state: up to four successors, and whether the step skipped a cell
+     * with # or wrapped around an edge */
+    struct cfg_step_t
+    {
+        std::array<std::uint16_t, 4> next;
+        std::size_t count = 0;
+        std::array<char const *, 4> kinds = {};
+        bool bridge = false;
+        bool wrapped = false;
+    };
+
+    cfg_step_t cfg_successors(grid_t const &grid, bool extensions, std::uint16_t state)
+    {
+        constexpr std::array<std::array<std::ptrdiff_t, 2>, 4> dirs {{{0, 1}, {0, -1}, {-1, 0}, {1, 0}}};
+        std::size_t const cell = state / 4;
+        std::size_t dir = state % 4;
+
+        cfg_step_t step;
+        auto advance = [&](std::size_t from, std::size_t towards) -> std::size_t
+        {
+            std::ptrdiff_t const x = static_cast<std::ptrdiff_t>(from % grid.cols) + dirs[towards][0];
+            std::ptrdiff_t const y = static_cast<std::ptrdiff_t>(from / grid.cols) + dirs[towards][1];
+            std::ptrdiff_t const cols = static_cast<std::ptrdiff_t>(grid.cols), rows = static_cast<std::ptrdiff_t>(grid.rows);
+            step.wrapped |= x < 0 || x >= cols || y < 0 || y >= rows;
+            return static_cast<std::size_t>((y + rows) % rows) * grid.cols + static_cast<std::size_t>((x + cols) % cols);
+        };
+        auto add = [&](std::size_t towards, char const *kind, std::size_t from)
+        {
+            step.next[step.count] = cfg_state(advance(from, towards), towards);
+            step.kinds[step.count++] = kind;
+        };
+
+        switch (grid.data[cell])
+        {
+            case '@': return step;
+            case '_': add(2, "nonzero", cell); add(3, "zero", cell); return step;
+            case '|': add(1, "nonzero", cell); add(0, "zero", cell); return step;
+
+            case '?':
+            {
+                for (std::size_t towards = 0; towards < 4; ++towards) add(towards, "random", cell);
+                return step;
+            }
+
+            case 'v': dir = 0; break;
+            case '^': dir = 1; break;
+            case '<': dir = 2; break;
+            case '>': dir = 3; break;
+
+            case '#':
+            {
+                step.bridge = true;
+                add(dir, "bridge", advance(cell, dir));
+                return step;
+            }
+
+            case '"':
+            {
+                std::size_t end = advance(cell, dir);
+                while (grid.data[end] != '"') end = advance(end, dir);
+                add(dir, "next", end);
+                return step;
+            }
+
+            case '\'':
+            {
+                if (!extensions) break;
+
+                add(dir, "next", advance(cell, dir));
+                return step;
+            }
+        }
+
+        add(dir, "next", cell);
+        return step;
+    }
+
+    /* the stack effect of one instruction, a block runs them in order */
+    std::pair<std::size_t, std::size_t> cfg_stack_effect(char ch, bool extensions)
+    {
+        switch (ch)
+        {
+            case '+': case '-': case '*': case '/': case '%': case '`': case 'g': return {2, 1};
+            case '!': return {1, 1};
+            case ':': return {1, 2};
+            case '\\': return {2, 2};
+            case '$': case '.': case ',': case '_': case '|': return {1, 0};
+            case 'p': return {3, 0};
+            case '&': case '~': return {0, 1};
+            case '\'': return {0, extensions ? 1 : 0};
+        }
+
+        if (ch >= '0' && ch <= '9') return {0, 1};
+        if (extensions && ch >= 'a' && ch <= 'f') return {0, 1};
+        return {0, 0};
+    }
+
+    /* constant folds a block far enough to find p instructions with constant coordinates, values
+     * from before the block are unknown */
+    void cfg_fold_puts(grid_t const &grid, bool extensions, cfg_block_t const &block, std::vector<std::size_t> &targets, bool &unknown)
+    {
+        std::vector<std::optional<std::int32_t>> stack;
+        auto pop = [&]() -> std::optional<std::int32_t>
+        {
+            if (stack.empty()) return std::nullopt;
+
+            std::optional<std::int32_t> const value = stack.back();
+            stack.pop_back();
+            return value;
+        };
+        auto binary = [&](auto op)
+        {
+            std::optional<std::int32_t> const a = pop(), b = pop();
+            stack.push_back(a && b ? std::optional<std::int32_t>{op(*b, *a)} : std::nullopt);
+        };
+
+        for (std::uint16_t const state : block.states)
+        {
+            std::size_t const cell = state / 4;
+            char const ch = grid.data[cell];
+            switch (ch)
+            {
+                case '+': binary([](std::int32_t b, std::int32_t a) { return static_cast<std::int32_t>(static_cast<std::uint32_t>(b) + static_cast<std::uint32_t>(a)); }); break;
+                case '-': binary([](std::int32_t b, std::int32_t a) { return static_cast<std::int32_t>(static_cast<std::uint32_t>(b) - static_cast<std::uint32_t>(a)); }); break;
+                case '*': binary([](std::int32_t b, std::int32_t a) { return static_cast<std::int32_t>(static_cast<std::uint32_t>(b) * static_cast<std::uint32_t>(a)); }); break;
+                case '/': binary(divide); break;
+                case '%': binary(modulo); break;
+                case '`': binary([](std::int32_t b, std::int32_t a) { return static_cast<std::int32_t>(b > a); }); break;
+
+                case '!':
+                {
+                    std::optional<std::int32_t> const value = pop();
+                    stack.push_back(value ? std::optional<std::int32_t>{*value == 0} : std::nullopt);
+                } break;
+
+                case ':':
+                {
+                    std::optional<std::int32_t> const value = stack.empty() ? std::nullopt : stack.back();
+                    stack.push_back(value);
+                    if (stack.size() == 1) stack.push_back(value);
+                } break;
+
+                case '\\':
+                {
+                    std::optional<std::int32_t> const a = pop(), b = pop();
+                    stack.push_back(a);
+                    stack.push_back(b);
+                } break;
+
+                case '"':
+                {
+                    for (char const ch : cfg_literal(grid, cell, state % 4)) stack.push_back(ch);
+                } break;
+
+                case 'p':
+                {
+                    std::optional<std::int32_t> const y = pop(), x = pop();
+                    pop();
+                    if (!x || !y) unknown = true;
+                    else if (*x >= 0 && *x < static_cast<std::int32_t>(max_col_size) && *y >= 0 && *y < static_cast<std::int32_t>(max_row_size))
+                    {
+                        targets.push_back(static_cast<std::size_t>(*y) * grid.cols + static_cast<std::size_t>(*x));
+                    }
+                } break;
+
+                default:
+                {
+                    if (ch >= '0' && ch <= '9') stack.push_back(ch - '0');
+                    else if (extensions && ch >= 'a' && ch <= 'f') stack.push_back(ch - 'a' + 10);
+                    else if (extensions && ch == '\'') stack.push_back(grid.data[cfg_advance(grid, cell, state % 4)]);
+                    else
+                    {
+                        auto const [pops, pushes] = cfg_stack_effect(ch, extensions);
+                        for (std::size_t i = 0; i < pops; ++i) pop();
+                        for (std::size_t i = 0; i < pushes; ++i) stack.push_back(std::nullopt);
+                    }
+                } break;
+            }
+        }
+    }
+
+    cfg_t build_cfg(grid_t const &grid, bool extensions)
+    {
+        constexpr std::size_t state_count = grid_cells * 4;
+        constexpr std::uint16_t entry = cfg_state(0, 3);
+
+        /* every state reachable from the entry, and how many transitions lead into each */
+        std::vector<std::uint8_t> reached(state_count, 0), leader(state_count, 0);
+        std::vector<std::uint32_t> incoming(state_count, 0);
+        std::vector<std::uint16_t> pending {entry};
+        reached[entry] = 1;
+        leader[entry] = 1;
+        while (!pending.empty())
+        {
+            std::uint16_t const state = pending.back();
+            pending.pop_back();
+
+            cfg_step_t const step = cfg_successors(grid, extensions, state);
+            for (std::size_t i = 0; i < step.count; ++i)
+            {
+                std::uint16_t const next = step.next[i];
+                ++incoming[next];
+                if (step.count > 1 || step.bridge || step.wrapped) leader[next] = 1;
+                if (!reached[next])
+                {
+                    reached[next] = 1;
+                    pending.push_back(next);
+                }
+            }
+        }
 
-            case 'a':
-            case 'b':
-            case 'c':
-            case 'd':
-            case 'e':
-            case 'f':
+        for (std::size_t state = 0; state < state_count; ++state) leader[state] |= incoming[state] > 1;
+
+        /* blocks in state order, so the entry block comes first */
+        cfg_t cfg;
+        std::vector<std::size_t> block_of(state_count, SIZE_MAX);
+        std::vector<std::uint16_t> leaders;
+        leaders.push_back(entry);
+        for (std::size_t state = 0; state < state_count; ++state)
+        {
+            if (reached[state] && leader[state] && state != entry) leaders.push_back(static_cast<std::uint16_t>(state));
+        }
+        for (std::size_t i = 0; i < leaders.size(); ++i) block_of[leaders[i]] = i;
+
+        std::vector<std::tuple<std::size_t, std::uint16_t, char const *>> exits;
+        for (std::uint16_t const first : leaders)
+        {
+            cfg_block_t block;
+            std::ptrdiff_t depth = 0, lowest = 0;
+            for (std::uint16_t state = first;;)
             {
-                if (!extensions) break;
+                char const ch = grid.data[state / 4];
+                block.states.push_back(state);
+                block.code += ch == '\0' ? ' ' : ch;
+                ++block.instructions;
 
-                push(ins - 'a' + 10);
-            } break;
+                auto [pops, pushes] = cfg_stack_effect(ch, extensions);
+                cfg_step_t const step = cfg_successors(grid, extensions, state);
+                if (ch == '"') pushes = cfg_literal(grid, state / 4, state % 4).size();
 
-            case '?':
+                depth -= static_cast<std::ptrdiff_t>(pops);
+                lowest = std::min(lowest, depth);
+                depth += static_cast<std::ptrdiff_t>(pushes);
+
+                bool const ends = step.count != 1 || step.bridge || step.wrapped || leader[step.next[0]];
+                if (!ends)
+                {
+                    state = step.next[0];
+                    continue;
+                }
+
+                for (std::size_t i = 0; i < step.count; ++i)
+                {
+                    exits.emplace_back(cfg.blocks.size(), step.next[i], step.wrapped && step.count == 1 ? "wrap" : step.kinds[i]);
+                }
+                break;
+            }
+
+            block.stack_in = static_cast<std::size_t>(-lowest);
+            block.stack_out = static_cast<std::size_t>(depth - lowest);
+            cfg.blocks.push_back(std::move(block));
+        }
+
+        for (auto const &[from, next, kind] : exits) cfg.edges.push_back({from, block_of[next], kind});
+
+        /* mark the blocks that constant p targets land in */
+        std::vector<std::size_t> targets;
+        for (auto const &block : cfg.blocks) cfg_fold_puts(grid, extensions, block, targets, cfg.unknown_puts);
+
+        std::vector<std::uint8_t> target_cells(grid_cells, 0);
+        for (std::size_t const cell : targets) target_cells[cell] = 1;
+        for (auto &block : cfg.blocks)
+        {
+            for (std::uint16_t const state : block.states) block.written |= target_cells[state / 4] != 0;
+        }
+
+        return cfg;
+    }
+
+    /* no, yes or maybe for the p annotation */
+    char const *cfg_written(cfg_t const &cfg, cfg_block_t const &block)
+    {
+        return block.written ? "yes" : cfg.unknown_puts ? "maybe" : "no";
+    }
+
+    /* executions of the block's first state, from the heat counters of a profiling run */
+    std::uint64_t cfg_count(stats_t const &stats, cfg_block_t const &block)
+    {
+        return stats.heat[block.states.front() / 4][block.states.front() % 4];
+    }
+
+    void print_cfg_dot(std::FILE *out, grid_t const &grid, cfg_t const &cfg, stats_t const *stats)
+    {
+        std::fprintf(out, "digraph cfg {\n  node [shape=box, fontname=monospace];\n");
+        for (std::size_t i = 0; i < cfg.blocks.size(); ++i)
+        {
+            auto const &block = cfg.blocks[i];
+            std::size_t const cell = block.states.front() / 4;
+            std::fprintf(out, "  b%zu [label=\"(%zu, %zu) %s\\n", i, cell % grid.cols, cell / grid.cols, dir_names[block.states.front() % 4]);
+            for (char const ch : block.code)
             {
-                dir = dirs[dist(engine)];
-            } break;
+                if (ch == '"' || ch == '\\') std::fprintf(out, "\\%c", ch);
+                else if (static_cast<unsigned char>(ch) < 0x20 || static_cast<unsigned char>(ch) >= 0x7f) std::fputc('?', out);
+                else std::fputc(ch, out);
+            }
+            std::fprintf(out, "\\n%zu ins, stack %zu -> %zu, p %s", block.instructions, block.stack_in, block.stack_out, cfg_written(cfg, block));
+            if (stats) std::fprintf(out, "\\nexecuted %" PRIu64, cfg_count(*stats, block));
+            std::fprintf(out, "\"];\n");
+        }
 
-            case '\'':
+        for (auto const &edge : cfg.edges) std::fprintf(out, "  b%zu -> b%zu [label=\"%s\"];\n", edge.from, edge.to, edge.kind);
+        std::fprintf(out, "}\n");
+    }
+
+    void print_cfg_json(std::FILE *out, grid_t const &grid, cfg_t const &cfg, stats_t const *stats)
+    {
+        std::fprintf(out, "{\n  \"blocks\": [");
+        for (std::size_t i = 0; i < cfg.blocks.size(); ++i)
+        {
+            auto const &block = cfg.blocks[i];
+            std::fprintf(out, "%s\n    {\"id\": %zu, \"code\": ", i == 0 ? "" : ",", i);
+            print_json_string(out, block.code);
+            std::fprintf(out, ", \"instructions\": %zu, \"stack_in\": %zu, \"stack_out\": %zu, \"p\": \"%s\"",
+                         block.instructions, block.stack_in, block.stack_out, cfg_written(cfg, block));
+            if (stats) std::fprintf(out, ", \"executed\": %" PRIu64, cfg_count(*stats, block));
+
+            std::fprintf(out, ", \"states\": [");
+            for (std::size_t j = 0; j < block.states.size(); ++j)
             {
-                if (!extensions) break;
+                std::size_t const cell = block.states[j] / 4;
+                std::fprintf(out, "%s[%zu, %zu, \"%s\"]", j == 0 ? "" : ", ", cell % grid.cols, cell / grid.cols, dir_names[block.states[j] % 4]);
+            }
+            std::fprintf(out, "]}");
+        }
 
-                move();
-                push(data[pos[1] * cols + pos[0]]);
-            } break;
+        std::fprintf(out, "\n  ],\n  \"edges\": [");
+        for (std::size_t i = 0; i < cfg.edges.size(); ++i)
+        {
+            auto const &edge = cfg.edges[i];
+            std::fprintf(out, "%s\n    {\"from\": %zu, \"to\": %zu, \"kind\": \"%s\"}", i == 0 ? "" : ",", edge.from, edge.to, edge.kind);
         }
+        std::fprintf(out, "\n  ]\n}\n");
+    }
 
-        move();
+    /* runs a program for the cell counters of stats with its output going to /dev/null, so a report
+     * on stdout stays readable */
+    void run_for_counts(std::size_t engine, unsigned hooks, grid_t const &grid, options_t const &options, stats_t &stats)
+    {
+        stats.track_cells();
+        event_log_t events;
+
+        std::fflush(stdout);
+        int const saved_stdout = dup(STDOUT_FILENO);
+        int const null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        close(null);
+
+        bool const completed = run_engine(engine, hooks, grid, options, stats, events);
+        std::fflush(stdout);
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+
+        if (!completed) std::fprintf(stderr, "Error: the profiling run did not finish, counts are partial\n");
+    }
+
+    /* prints the control flow graph of a program in options.dump_cfg's format. with --cfg-profile the
+     * program first runs on the switch engine with its output discarded, and each block carries how
+     * often it was entered */
+    bool dump_cfg(std::string_view filepath, options_t const &options)
+    {
+        grid_t const grid = readfile(filepath);
+        cfg_t const cfg = build_cfg(grid, options.extensions);
+
+        std::unique_ptr<stats_t> stats;
+        if (options.cfg_profile)
+        {
+            stats = std::make_unique<stats_t>();
+            run_for_counts(engine_switch, hook_count | hook_stats, grid, options, *stats);
+        }
+
+        if (options.dump_cfg == "dot") print_cfg_dot(stdout, grid, cfg, stats.get());
+        else print_cfg_json(stdout, grid, cfg, stats.get());
+        return true;
+    }
+
+    constexpr std::array<char const *, 30> op_names {
+        "nop", "add", "subtract", "divide", "multiply", "modulo", "not", "greater",
+        "south", "north", "west", "east", "if_horizontal", "if_vertical",
+        "string", "duplicate", "swap", "discard", "output_int", "output_char", "bridge",
+        "get", "put", "input_int", "input_char", "end", "push", "random", "fetch", "trap"
+    };
+
+    /* one decoded instruction with what it carries: the immediate of push, the literal string mode
+     * walks and the cell fetch reads */
+    std::string disasm_op(grid_t const &grid, decoded_program_t const &program, std::uint16_t state)
+    {
+        std::size_t const cell = state / 4;
+        op_t const op = program.ops[cell];
+        std::string text = op_names[static_cast<std::size_t>(op)];
+        if (op == op_t::push) text += ' ' + std::to_string(program.values[cell]);
+        if (op == op_t::string_mode) text += " \"" + cfg_literal(grid, cell, state % 4) + '"';
+        if (op == op_t::fetch) text += " '" + std::string(1, grid.data[program.next[cell][state % 4]]) + '\'';
+        return text;
+    }
+
+    /* lists the decoded program in the blocks of its control flow graph, one instruction per line with
+     * its cell and direction, nops collapsed into runs. the program then runs on options.engine (the
+     * decoded one for switch) with its output discarded, and every cell that p decoded into a
+     * different instruction is marked where it appears and listed at the end */
+    bool disasm(std::string_view filepath, options_t options)
+    {
+        grid_t const grid = readfile(filepath);
+        std::unique_ptr<decoded_program_t> const program = std::make_unique<decoded_program_t>();
+        decode(grid, options.extensions, *program);
+        cfg_t const cfg = build_cfg(grid, options.extensions);
+
+        std::size_t const engine = options.engine == engine_switch ? std::size_t{engine_decoded} : options.engine;
+        std::unique_ptr<stats_t> const stats = std::make_unique<stats_t>();
+        std::unique_ptr<final_state_t> const final_state = std::make_unique<final_state_t>();
+        options.final_state = final_state.get();
+        run_for_counts(engine, hook_count, grid, options, *stats);
+
+        /* what the cells p rewrote decode to at the end of the run */
+        grid_t rewritten = grid;
+        rewritten.data = final_state->data;
+        std::unique_ptr<decoded_program_t> const final_program = std::make_unique<decoded_program_t>();
+        decode(rewritten, options.extensions, *final_program);
+        auto const invalidated = [&](std::size_t cell)
+        {
+            return stats->writes[cell] > 0 && (program->ops[cell] != final_program->ops[cell] || program->values[cell] != final_program->values[cell]);
+        };
+
+        std::size_t invalidated_cells = 0;
+        for (std::size_t cell = 0; cell < grid_cells; ++cell) invalidated_cells += invalidated(cell);
+
+        std::printf("; %.*s on the %s engine: %zu blocks, %" PRIu64 " instructions executed, %zu cells decoded again by p\n",
+                    static_cast<int>(filepath.size()), filepath.data(), tier_names[engine], cfg.blocks.size(),
+                    stats->instructions, invalidated_cells);
+
+        for (std::size_t i = 0; i < cfg.blocks.size(); ++i)
+        {
+            auto const &block = cfg.blocks[i];
+            std::printf("\nblock %zu: stack %zu -> %zu, p %s\n", i, block.stack_in, block.stack_out, cfg_written(cfg, block));
+            for (std::size_t j = 0; j < block.states.size(); ++j)
+            {
+                std::uint16_t const state = block.states[j];
+                std::size_t const cell = state / 4;
+                std::size_t run = 1;
+                while (program->ops[cell] == op_t::nop && j + run < block.states.size() && program->ops[block.states[j + run] / 4] == op_t::nop &&
+                       !invalidated(block.states[j + run] / 4))
+                {
+                    ++run;
+                }
+
+                std::string const op = disasm_op(grid, *program, state);
+                std::printf("  %2zu,%-2zu %-5s %s", cell % grid.cols, cell / grid.cols, dir_names[state % 4], op.c_str());
+                if (run > 1) std::printf(" x%zu", run);
+                if (invalidated(cell))
+                {
+                    std::string const now = disasm_op(rewritten, *final_program, state);
+                    std::printf("    ; p wrote it %" PRIu64 " times, now %s", stats->writes[cell], now.c_str());
+                }
+                std::printf("\n");
+                j += run - 1;
+            }
+
+            for (auto const &edge : cfg.edges)
+            {
+                if (edge.from == i) std::printf("  -> block %zu (%s)\n", edge.to, edge.kind);
+            }
+        }
+
+        if (invalidated_cells > 0)
+        {
+            std::printf("\n; decoded again by p\n");
+            for (std::size_t cell = 0; cell < grid_cells; ++cell)
+            {
+                if (!invalidated(cell)) continue;
+
+                std::printf("  %2zu,%-2zu %s -> %s, %" PRIu64 " writes\n", cell % grid.cols, cell / grid.cols,
+                            disasm_op(grid, *program, cfg_state(cell, 3)).c_str(), disasm_op(rewritten, *final_program, cfg_state(cell, 3)).c_str(),
+                            stats->writes[cell]);
+            }
+        }
+
+        return true;
+    }
+
+    /* runs the program on the decoded engine under a debugger_t. with - the commands come from stdin
+     * and the replies go to stderr, otherwise b93 listens on a unix socket at the path and serves the
+     * first connection */
+    bool debug(std::string_view filepath, options_t options)
+    {
+        grid_t const grid = readfile(filepath);
+
+        /* commands and the program's own input would take turns reading stdin. a p that writes ~ or &
+         * later still can, which the readme warns about */
+        bool const reads_input = std::any_of(grid.data.begin(), grid.data.end(), [](char ch) { return ch == '~' || ch == '&'; });
+        if (options.debug == "-" && reads_input && options.replay.empty())
+        {
+            std::fprintf(stderr, "Error: %.*s reads stdin, which --debug=- uses for commands. debug it over a socket path or with --replay\n",
+                         static_cast<int>(filepath.size()), filepath.data());
+            return false;
+        }
+
+        event_log_t events;
+        if (!options.replay.empty())
+        {
+            events.mode = event_log_t::mode_t::replay;
+            if (!events.load(std::string{options.replay}))
+            {
+                std::fprintf(stderr, "Error: could not load replay log %.*s\n", static_cast<int>(options.replay.size()), options.replay.data());
+                return false;
+            }
+        }
+
+        std::FILE *in = stdin, *out = stderr;
+        if (options.debug != "-")
+        {
+            std::string const path {options.debug};
+            sockaddr_un address = {};
+            address.sun_family = AF_UNIX;
+            if (path.size() >= sizeof address.sun_path)
+            {
+                std::fprintf(stderr, "Error: socket path %s is too long\n", path.c_str());
+                return false;
+            }
+            std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+            int const listener = socket(AF_UNIX, SOCK_STREAM, 0);
+            unlink(path.c_str());
+            if (listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof address) != 0 || listen(listener, 1) != 0)
+            {
+                std::fprintf(stderr, "Error: could not listen on %s: %s\n", path.c_str(), std::strerror(errno));
+                if (listener >= 0) close(listener);
+                return false;
+            }
+
+            std::fprintf(stderr, "waiting for a debugger on %s\n", path.c_str());
+            int const connection = accept(listener, nullptr, nullptr);
+            close(listener);
+            unlink(path.c_str());
+            if (connection < 0)
+            {
+                std::fprintf(stderr, "Error: could not accept a debugger: %s\n", std::strerror(errno));
+                return false;
+            }
+
+            in = fdopen(connection, "r");
+            out = fdopen(dup(connection), "w");
+        }
+
+        debugger_t debugger {in, out, options.checkpoint_interval};
+        options.debugger = &debugger;
+        std::unique_ptr<stats_t> const stats = std::make_unique<stats_t>();
+        bool const completed = interpret_decoded<hook_count | hook_debug>(grid, options, *stats, events);
+        std::fflush(stdout);
+        debugger.finish(completed ? "exited" : stats->instructions == options.max_steps ? "out of steps" : "quit", stats->instructions);
+
+        if (in != stdin)
+        {
+            std::fclose(in);
+            std::fclose(out);
+        }
+        return completed;
+    }
+
+    /* matches --name=value or --name value, advancing i past a separate value */
+    bool option_value(int argc, char **argv, int &i, std::string_view name, std::string_view &value)
+    {
+        std::string_view const arg = argv[i];
+        if (arg.substr(0, name.size()) != name) return false;
+
+        if (arg.size() > name.size() && arg[name.size()] == '=')
+        {
+            value = arg.substr(name.size() + 1);
+            return true;
+        }
+
+        if (arg.size() == name.size() && i + 1 < argc)
+        {
+            value = argv[++i];
+            return true;
+        }
+
+        return false;
     }
 }
 
 int main(int argc, char **argv)
 {
-    for (int i = 0; i + 1 < argc; ++i)
+    options_t options;
+    bool pending_options = false;
+    bool failed = false;
+
+    /* unlike the per file options, tracing covers every job of the invocation */
+    std::string trace_path;
+
+    for (int i = 1; i < argc; ++i)
     {
-        bool extensions = false;
-        if(std::string_view argv_sv = std::string_view{argv[i + 1]}; argv_sv.substr(0, 12) == "--extensions")
+        std::string_view value;
+        if(std::string_view argv_sv = std::string_view{argv[i]}; argv_sv.substr(0, 12) == "--extensions")
         {
             if (argv_sv.find("true", 12) != std::string_view::npos)
             {
-                extensions = true;
+                options.extensions = true;
             }
             else if (argv_sv.find("false", 12) != std::string_view::npos)
             {
-                extensions = false;
+                options.extensions = false;
             }
             else
             {
                 std::fprintf(stderr, "Error: invalid arguments\n");
                 return EXIT_FAILURE;
             }
+        }
+        else if (option_value(argc, argv, i, "--stats", value))
+        {
+            if (value != "json")
+            {
+                std::fprintf(stderr, "Error: unsupported stats format %.*s\n", static_cast<int>(value.size()), value.data());
+                return EXIT_FAILURE;
+            }
+
+            options.stats = true;
+        }
+        else if (option_value(argc, argv, i, "--engine", value))
+        {
+            auto const found = std::find(tier_names.begin(), tier_names.end(), value);
+            if (found == tier_names.end())
+            {
+                std::fprintf(stderr, "Error: unknown engine %.*s\n", static_cast<int>(value.size()), value.data());
+                return EXIT_FAILURE;
+            }
+
+            options.engine = static_cast<std::size_t>(found - tier_names.begin());
+        }
+        else if (argv_sv == "--compare-engines")
+        {
+            options.compare_engines = true;
+        }
+        else if (argv_sv == "--list-engines")
+        {
+            for (char const *name : tier_names) std::printf("%s\n", name);
+            return EXIT_SUCCESS;
+        }
+        else if (option_value(argc, argv, i, "--heatmap", value))
+        {
+            options.heatmap = value;
+        }
+        else if (option_value(argc, argv, i, "--sample-profile", value))
+        {
+#ifndef __linux__
+            std::fprintf(stderr, "Error: --sample-profile is only supported on linux\n");
+            return EXIT_FAILURE;
+#endif
+            options.sample_hz = std::strtol(std::string{value}.c_str(), nullptr, 10);
+            if (options.sample_hz <= 0)
+            {
+                std::fprintf(stderr, "Error: invalid sampling rate %.*s\n", static_cast<int>(value.size()), value.data());
+                return EXIT_FAILURE;
+            }
+        }
+        else if (option_value(argc, argv, i, "--trace-events", value))
+        {
+            trace_path = value;
+            tracing.store(true);
+        }
+        else if (option_value(argc, argv, i, "--telemetry-shm", value))
+        {
+            options.telemetry_shm = value;
+        }
+        else if (option_value(argc, argv, i, "--telemetry-interval", value))
+        {
+            telemetry_interval = std::strtoull(std::string{value}.c_str(), nullptr, 10);
+            if (telemetry_interval == 0)
+            {
+                std::fprintf(stderr, "Error: invalid telemetry interval %.*s\n", static_cast<int>(value.size()), value.data());
+                return EXIT_FAILURE;
+            }
+        }
+        else if (option_value(argc, argv, i, "--monitor", value))
+        {
+            return monitor(value);
+        }
+        else if (option_value(argc, argv, i, "--decode-flight", value))
+        {
+            return decode_flight(value);
+        }
+        else if (option_value(argc, argv, i, "--flight-recorder", value))
+        {
+            options.flight_recorder = std::strtoull(std::string{value}.c_str(), nullptr, 10);
+            if (options.flight_recorder == 0 || options.flight_recorder > max_flight_records)
+            {
+                std::fprintf(stderr, "Error: invalid flight recorder size %.*s\n", static_cast<int>(value.size()), value.data());
+                return EXIT_FAILURE;
+            }
+        }
+        else if (option_value(argc, argv, i, "--record", value))
+        {
+            options.record = value;
+        }
+        else if (option_value(argc, argv, i, "--replay", value))
+        {
+            options.replay = value;
+        }
+        else if (option_value(argc, argv, i, "--repeat", value))
+        {
+            options.repeat = std::strtoull(std::string{value}.c_str(), nullptr, 10);
+            if (options.repeat == 0)
+            {
+                std::fprintf(stderr, "Error: invalid repeat count %.*s\n", static_cast<int>(value.size()), value.data());
+                return EXIT_FAILURE;
+            }
+        }
+        else if (option_value(argc, argv, i, "--sink", value))
+        {
+            options.sink = value;
+        }
+        else if (option_value(argc, argv, i, "--seed", value))
+        {
+            options.seeded = true;
+            options.seed = static_cast<std::uint32_t>(std::strtoul(std::string{value}.c_str(), nullptr, 10));
+        }
+        else if (option_value(argc, argv, i, "--max-steps", value))
+        {
+            options.max_steps = std::strtoull(std::string{value}.c_str(), nullptr, 10);
+            if (options.max_steps == 0)
+            {
+                std::fprintf(stderr, "Error: invalid step budget %.*s\n", static_cast<int>(value.size()), value.data());
+                return EXIT_FAILURE;
+            }
+        }
+        else if (argv_sv == "--smc-report")
+        {
+            options.smc_report = true;
+        }
+        else if (option_value(argc, argv, i, "--smc-hints", value))
+        {
+            options.smc_hints = value;
+        }
+        else if (argv_sv == "--perf-counters")
+        {
+#ifndef __linux__
+            std::fprintf(stderr, "Error: --perf-counters is only supported on linux\n");
+            return EXIT_FAILURE;
+#endif
+            options.perf_counters = true;
+        }
+        else if (option_value(argc, argv, i, "--dump-cfg", value))
+        {
+            if (value != "dot" && value != "json")
+            {
+                std::fprintf(stderr, "Error: unsupported cfg format %.*s\n", static_cast<int>(value.size()), value.data());
+                return EXIT_FAILURE;
+            }
 
-            i += 1;
-            if(i + 1 >= argc)
+            options.dump_cfg = value;
+        }
+        else if (argv_sv == "--cfg-profile")
+        {
+            options.cfg_profile = true;
+        }
+        else if (argv_sv == "--disasm")
+        {
+            options.disasm = true;
+        }
+        else if (option_value(argc, argv, i, "--debug", value))
+        {
+            options.debug = value;
+        }
+        else if (option_value(argc, argv, i, "--checkpoint-interval", value))
+        {
+            options.checkpoint_interval = std::strtoull(std::string{value}.c_str(), nullptr, 10);
+            if (options.checkpoint_interval == 0)
             {
-                std::fprintf(stderr, "Error: exptected a file\n");
+                std::fprintf(stderr, "Error: invalid checkpoint interval %.*s\n", static_cast<int>(value.size()), value.data());
                 return EXIT_FAILURE;
             }
         }
+        else if (argv_sv.substr(0, 2) == "--")
+        {
+            std::fprintf(stderr, "Error: invalid arguments\n");
+            return EXIT_FAILURE;
+        }
+        else
+        {
+            /* options apply to the file that follows them */
+            failed |= !(!options.dump_cfg.empty() ? dump_cfg(argv_sv, options)
+                        : options.disasm          ? disasm(argv_sv, options)
+                        : !options.debug.empty()  ? debug(argv_sv, options)
+                        : options.compare_engines ? compare_engines(argv_sv, options)
+                        : options.repeat > 0      ? repeat(argv_sv, options)
+                                                  : run(argv_sv, options));
+            options = {};
+            pending_options = false;
+            continue;
+        }
+
+        pending_options = true;
+    }
+
+    if (pending_options)
+    {
+        std::fprintf(stderr, "Error: exptected a file\n");
+        return EXIT_FAILURE;
+    }
 
-        interpret(argv[i + 1], extensions);
+    if (!trace_path.empty())
+    {
+        write_trace(trace_path);
     }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -0,0 +1,346 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <string_view>
+#include <type_traits>
+
+/* a befunge-93 interpreter that runs at compile time. a program that takes no input and never
+ * executes ? prints the same thing every time, so its output can be computed by the compiler and
+ * embedded as a std::array<char, N>:
+ *
+ *     struct hello { static constexpr std::string_view source = "\"olleh\",,,,,@"; };
+ *     constexpr auto output = b93::bake<hello>();
+ *
+ * everything here behaves like the switch engine of b93.cc and works at runtime too. b93.cc takes
+ * load(), divide(), modulo() and truncate() from here, so the engines share their semantics; run()
+ * keeps its own loop because the compiler needs fixed size state and no hooks */
+
+namespace b93
+{
+    constexpr std::size_t max_row_size = 25;
+    constexpr std::size_t max_col_size = 80;
+
+    /* one column past the program like b93.cc, so wrapping lands on the same cells */
+    constexpr std::size_t grid_cols = max_col_size + 1;
+    constexpr std::size_t grid_cells = max_row_size * grid_cols;
+
+    constexpr std::uint64_t default_budget = std::uint64_t{1} << 26;
+
+    using grid_t = std::array<char, grid_cells>;
+
+    /* why a run stopped. only finished is a baked program */
+    enum class status_t
+    {
+        finished,
+        out_of_steps,
+        stack_full,
+        output_full,
+        needs_input,
+        needs_random,
+    };
+
+    constexpr std::string_view status_name(status_t status)
+    {
+        constexpr std::array<std::string_view, 6> names {"finished", "out of steps", "stack full", "output full", "needs input", "needs random"};
+        return names[static_cast<std::size_t>(status)];
+    }
+
+    /* lays a program out on the grid, dropping what falls outside 80x25 */
+    constexpr grid_t load(std::string_view source)
+    {
+        grid_t grid = {};
+        std::size_t row = 0, col = 0;
+        for (char const ch : source)
+        {
+            if (row == max_row_size) break;
+
+            /* skip characters that are not a unicode code point */
+            if ((static_cast<unsigned char>(ch) & 0xC0u) == 0x80u) continue;
+
+            /* for every newline increase the row count */
+            if (ch == '\n')
+            {
+                ++row;
+                col = 0;
+                continue;
+            }
+
+            if (col < max_col_size) grid[row * grid_cols + col] = ch;
+            ++col;
+        }
+
+        return grid;
+    }
+
+    /* signed overflow is not a constant expression, so arithmetic wraps through unsigned like the
+     * runtime engines do in practice */
+    constexpr std::int32_t wrap(std::uint32_t value)
+    {
+        return value <= 0x7FFFFFFFu ? static_cast<std::int32_t>(value) : -static_cast<std::int32_t>(~value) - 1;
+    }
+
+    constexpr std::int32_t add(std::int32_t a, std::int32_t b)
+    {
+        return wrap(static_cast<std::uint32_t>(a) + static_cast<std::uint32_t>(b));
+    }
+
+    constexpr std::int32_t subtract(std::int32_t b, std::int32_t a)
+    {
+        return wrap(static_cast<std::uint32_t>(b) - static_cast<std::uint32_t>(a));
+    }
+
+    constexpr std::int32_t multiply(std::int32_t a, std::int32_t b)
+    {
+        return wrap(static_cast<std::uint32_t>(a) * static_cast<std::uint32_t>(b));
+    }
+
+    /* division by zero gives 0, and INT32_MIN / -1 wraps */
+    constexpr std::int32_t divide(std::int32_t b, std::int32_t a)
+    {
+        return a == 0 ? 0 : a == -1 ? wrap(0u - static_cast<std::uint32_t>(b)) : b / a;
+    }
+
+    constexpr std::int32_t modulo(std::int32_t b, std::int32_t a)
+    {
+        return a == 0 || a == -1 ? 0 : b % a;
+    }
+
+    /* the playfield stores what p writes truncated to a char */
+    constexpr char truncate(std::int32_t value)
+    {
+        std::uint8_t const byte = static_cast<std::uint8_t>(static_cast<std::uint32_t>(value) & 0xFFu);
+        return static_cast<char>(byte <= 0x7F ? byte : byte - 0x100);
+    }
+
+    /* the state of a run, fixed size so the compiler can evaluate it */
+    template <std::size_t StackCapacity, std::size_t OutputCapacity>
+    struct machine_t
+    {
+        grid_t grid = {};
+        std::array<std::int32_t, StackCapacity> stack = {};
+        std::size_t depth = 0;
+        std::array<char, OutputCapacity> output = {};
+        std::size_t written = 0;
+        std::uint64_t steps = 0;
+        status_t status = status_t::finished;
+    };
+
+    /* runs a program until @ or until it needs more than the budget, the stack or the output buffer
+     * has, or something the compiler cannot give it. the default stack of 1024 is small for some
+     * programs: tests/soup.b93 reaches a depth of 1743 and stops with stack_full unless it gets more */
+    template <std::size_t StackCapacity = 1024, std::size_t OutputCapacity = 1 << 16>
+    constexpr machine_t<StackCapacity, OutputCapacity> run(grid_t const &grid, bool extensions = false, std::uint64_t max_steps = default_budget)
+    {
+        machine_t<StackCapacity, OutputCapacity> machine;
+        auto &[data, stack, depth, output, written, steps, status] = machine;
+        data = grid;
+
+        /* the stack and output report being full through status, which ends the loop */
+        auto push = [&](std::int32_t value) -> void
+        {
+            if (depth == StackCapacity) status = status_t::stack_full;
+            else stack[depth++] = value;
+        };
+        auto pop = [&]() -> std::int32_t
+        {
+            return depth == 0 ? 0 : stack[--depth];
+        };
+        auto print = [&](char ch) -> void
+        {
+            if (written == OutputCapacity) status = status_t::output_full;
+            else output[written++] = ch;
+        };
+
+        /* positions stay in range, so a step is an add and at most one wrap */
+        std::size_t x = 0, y = 0, dir = 3;
+        auto move = [&]() -> void
+        {
+            switch (dir)
+            {
+                case 0: y = y + 1 == max_row_size ? 0 : y + 1; break;
+                case 1: y = y == 0 ? max_row_size - 1 : y - 1; break;
+                case 2: x = x == 0 ? grid_cols - 1 : x - 1; break;
+                default: x = x + 1 == grid_cols ? 0 : x + 1; break;
+            }
+        };
+
+        for (; status == status_t::finished; move())
+        {
+            if (steps == max_steps)
+            {
+                status = status_t::out_of_steps;
+                break;
+            }
+            ++steps;
+
+            char const ins = data[y * grid_cols + x];
+            switch (ins)
+            {
+                case '+': push(add(pop(), pop())); break;
+                case '*': push(multiply(pop(), pop())); break;
+
+                case '-':
+                {
+                    std::int32_t const a = pop();
+                    std::int32_t const b = pop();
+                    push(subtract(b, a));
+                } break;
+
+                case '/':
+                {
+                    std::int32_t const a = pop();
+                    std::int32_t const b = pop();
+                    push(divide(b, a));
+                } break;
+
+                case '%':
+                {
+                    std::int32_t const a = pop();
+                    std::int32_t const b = pop();
+                    push(modulo(b, a));
+                } break;
+
+                case '!':
+                {
+                    if (depth == 0) push(1);
+                    else stack[depth - 1] = stack[depth - 1] == 0;
+                } break;
+
+                case '`':
+                {
+                    std::int32_t const a = pop();
+                    std::int32_t const b = pop();
+                    push(b > a);
+                } break;
+
+                case 'v': dir = 0; break;
+                case '^': dir = 1; break;
+                case '<': dir = 2; break;
+                case '>': dir = 3; break;
+                case '_': dir = pop() != 0 ? 2 : 3; break;
+                case '|': dir = pop() != 0 ? 1 : 0; break;
+
+                case '"':
+                {
+                    for (move(); data[y * grid_cols + x] != '"' && status == status_t::finished; move()) push(data[y * grid_cols + x]);
+                } break;
+
+                case ':': push(depth == 0 ? 0 : stack[depth - 1]); break;
+
+                case '\\':
+                {
+                    if (depth >= 2)
+                    {
+                        std::int32_t const top = stack[depth - 1];
+                        stack[depth - 1] = stack[depth - 2];
+                        stack[depth - 2] = top;
+                    }
+                    else if (depth == 1)
+                    {
+                        push(0);
+                    }
+                } break;
+
+                case '$': pop(); break;
+
+                /* the digits of the value and a space, like printf("%d ") */
+                case '.':
+                {
+                    std::int32_t const value = pop();
+                    std::uint32_t magnitude = value < 0 ? 0u - static_cast<std::uint32_t>(value) : static_cast<std::uint32_t>(value);
+                    std::array<char, 10> digits = {};
+                    std::size_t count = 0;
+                    do
+                    {
+                        digits[count++] = static_cast<char>('0' + magnitude % 10);
+                        magnitude /= 10;
+                    } while (magnitude != 0);
+
+                    if (value < 0) print('-');
+                    while (count > 0) print(digits[--count]);
+                    print(' ');
+                } break;
+
+                case ',': print(truncate(pop())); break;
+                case '#': move(); break;
+
+                case 'g':
+                {
+                    std::int32_t const row = pop();
+                    std::int32_t const col = pop();
+                    bool const in_bounds = col >= 0 && col < static_cast<std::int32_t>(max_col_size) &&
+                                           row >= 0 && row < static_cast<std::int32_t>(max_row_size);
+                    push(in_bounds ? data[row * grid_cols + col] : 0);
+                } break;
+
+                case 'p':
+                {
+                    std::int32_t const row = pop();
+                    std::int32_t const col = pop();
+                    std::int32_t const value = pop();
+                    if (col >= 0 && col < static_cast<std::int32_t>(max_col_size) && row >= 0 && row < static_cast<std::int32_t>(max_row_size))
+                    {
+                        data[row * grid_cols + col] = truncate(value);
+                    }
+                } break;
+
+                /* the output would depend on the run */
+                case '&':
+                case '~': status = status_t::needs_input; return machine;
+                case '?': status = status_t::needs_random; return machine;
+
+                case '@': return machine;
+
+                case '\'':
+                {
+                    if (!extensions) break;
+
+                    move();
+                    push(data[y * grid_cols + x]);
+                } break;
+
+                default:
+                {
+                    if (ins >= '0' && ins <= '9') push(ins - '0');
+                    else if (extensions && ins >= 'a' && ins <= 'f') push(ins - 'a' + 10);
+                } break;
+            }
+        }
+
+        return machine;
+    }
+
+    /* Program::extensions, or false when it declares none */
+    template <typename Program, typename = void>
+    struct extensions_of
+    {
+        static constexpr bool value = false;
+    };
+
+    template <typename Program>
+    struct extensions_of<Program, std::void_t<decltype(Program::extensions)>>
+    {
+        static constexpr bool value = Program::extensions;
+    };
+
+    /* the output of Program::source as an array of exactly its length. Program may also declare
+     * static constexpr bool extensions, and the budget and buffers are template arguments so a
+     * failing program stops the build with the reason. deep programs such as tests/soup.b93 (1743)
+     * need a StackCapacity above the default 1024 */
+    template <typename Program, std::uint64_t Budget = default_budget, std::size_t StackCapacity = 1024, std::size_t OutputCapacity = 1 << 16>
+    constexpr auto bake()
+    {
+        constexpr auto machine = run<StackCapacity, OutputCapacity>(load(Program::source), extensions_of<Program>::value, Budget);
+        static_assert(machine.status != status_t::out_of_steps, "the program did not finish within the step budget");
+        static_assert(machine.status != status_t::stack_full, "the program needs a larger StackCapacity");
+        static_assert(machine.status != status_t::output_full, "the program needs a larger OutputCapacity");
+        static_assert(machine.status != status_t::needs_input, "the program reads input, its output is not known at compile time");
+        static_assert(machine.status != status_t::needs_random, "the program executes ?, its output is not known at compile time");
+
+        std::array<char, machine.written> output = {};
+        for (std::size_t i = 0; i < output.size(); ++i) output[i] = machine.output[i];
+        return output;
+    }
+}
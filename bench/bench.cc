@@ -0,0 +1,450 @@
+#include <cstdio>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <string>
+#include <array>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "spawn.hh"
+
+/* runs the benchmark corpus through b93 and reports wall time, instructions per second and cycles
+ * per instruction for every case. see bench/corpus.txt for the cases */
+
+namespace
+{
+    struct bench_case_t
+    {
+        std::string name;
+        std::string path;
+        std::vector<std::string> flags;
+    };
+
+    struct options_t
+    {
+        std::string b93 = "./b93";
+        std::string corpus = "bench/corpus.txt";
+        std::size_t runs = 10;
+        std::size_t warmup = 2;
+        bool json = false;
+        std::string save_baseline;
+        std::string check;
+
+        /* slowdowns below this fraction are not regressions however significant */
+        double tolerance = 0.05;
+    };
+
+    /* each line: name path [b93 flags...], blank lines and lines starting with # are skipped */
+    std::vector<bench_case_t> read_corpus(std::string const &path)
+    {
+        std::ifstream file {path};
+        if (!file.good())
+        {
+            std::fprintf(stderr, "Error: could not open %s\n", path.c_str());
+            std::exit(EXIT_FAILURE);
+        }
+
+        std::vector<bench_case_t> cases;
+        for (std::string line; std::getline(file, line);)
+        {
+            std::istringstream words {line};
+            bench_case_t bench_case;
+            if (!(words >> bench_case.name) || bench_case.name[0] == '#') continue;
+            if (!(words >> bench_case.path))
+            {
+                std::fprintf(stderr, "Error: case %s has no program\n", bench_case.name.c_str());
+                std::exit(EXIT_FAILURE);
+            }
+
+            for (std::string flag; words >> flag;) bench_case.flags.push_back(flag);
+            cases.push_back(std::move(bench_case));
+        }
+
+        return cases;
+    }
+
+    /* counts cycles of the children spawned while it is enabled. falls back to the time stamp
+     * counter (reference cycles) when the kernel has no hardware counters for us */
+    class cycle_counter_t
+    {
+    public:
+        cycle_counter_t()
+        {
+            perf_event_attr attr = {};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.inherit = 1;
+            attr.disabled = 1;
+            fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fd >= 0) return;
+
+#if defined(__x86_64__) || defined(__i386__)
+            auto const start = std::chrono::steady_clock::now();
+            std::uint64_t const ticks = __rdtsc();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            tsc_hz = static_cast<double>(__rdtsc() - ticks) /
+                     std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+#endif
+        }
+
+        cycle_counter_t(cycle_counter_t const &) = delete;
+        cycle_counter_t &operator=(cycle_counter_t const &) = delete;
+
+        ~cycle_counter_t()
+        {
+            if (fd >= 0) close(fd);
+        }
+
+        char const *source() const
+        {
+            return fd >= 0 ? "perf" : tsc_hz > 0 ? "tsc" : "none";
+        }
+
+        void start()
+        {
+            if (fd < 0) return;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+
+        /* cycles since start(), or a negative value when nothing can count them */
+        double stop(double wall_seconds)
+        {
+            if (fd < 0) return tsc_hz > 0 ? wall_seconds * tsc_hz : -1;
+
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            std::uint64_t cycles = 0;
+            return read(fd, &cycles, sizeof(cycles)) == sizeof(cycles) ? static_cast<double>(cycles) : -1;
+        }
+
+    private:
+        int fd = -1;
+        double tsc_hz = 0;
+    };
+
+    struct result_t
+    {
+        std::string name;
+        std::size_t runs;
+        double median_seconds;
+        double p95_seconds;
+        std::uint64_t instructions;
+        double instructions_per_second;
+
+        /* negative when no cycle source is available */
+        double cycles_per_instruction;
+
+        /* every timed run, sorted */
+        std::vector<double> seconds;
+    };
+
+    /* nearest rank percentile of sorted samples */
+    double percentile(std::vector<double> const &sorted, double fraction)
+    {
+        std::size_t const rank = static_cast<std::size_t>(fraction * static_cast<double>(sorted.size()) + 0.999999);
+        return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    result_t run_case(bench_case_t const &bench_case, options_t const &options, cycle_counter_t &cycles)
+    {
+        /* one counting run records the ? outcomes, the timed runs replay them so every run does the same work */
+        std::string const log = "/tmp/b93-bench-" + std::to_string(getpid()) + ".log";
+        std::vector<std::string> args {options.b93, "--stats=json", "--record", log};
+        args.insert(args.end(), bench_case.flags.begin(), bench_case.flags.end());
+        args.push_back(bench_case.path);
+
+        std::string report;
+        std::uint64_t const instructions = bench::spawn(args, true, report) ? bench::stats_instructions(report) : 0;
+        if (instructions == 0)
+        {
+            std::fprintf(stderr, "Error: counting run of %s failed\n%s", bench_case.name.c_str(), report.c_str());
+            std::exit(EXIT_FAILURE);
+        }
+
+        args = {options.b93, "--replay", log};
+        args.insert(args.end(), bench_case.flags.begin(), bench_case.flags.end());
+        args.push_back(bench_case.path);
+
+        std::vector<double> seconds;
+        double total_cycles = 0;
+        for (std::size_t i = 0; i < options.warmup + options.runs; ++i)
+        {
+            std::string unused;
+            cycles.start();
+            auto const start = std::chrono::steady_clock::now();
+            bool const ok = bench::spawn(args, false, unused);
+            double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            double const counted = cycles.stop(elapsed);
+
+            if (!ok)
+            {
+                std::fprintf(stderr, "Error: %s failed\n", bench_case.name.c_str());
+                std::exit(EXIT_FAILURE);
+            }
+
+            if (i < options.warmup) continue;
+            seconds.push_back(elapsed);
+            total_cycles = total_cycles < 0 || counted < 0 ? -1 : total_cycles + counted;
+        }
+        std::remove(log.c_str());
+
+        std::sort(seconds.begin(), seconds.end());
+        double const median = seconds.size() % 2 != 0
+            ? seconds[seconds.size() / 2]
+            : (seconds[seconds.size() / 2 - 1] + seconds[seconds.size() / 2]) / 2;
+
+        return {bench_case.name, options.runs, median, percentile(seconds, 0.95), instructions,
+                median > 0 ? static_cast<double>(instructions) / median : 0,
+                total_cycles < 0 || instructions == 0 ? -1 : total_cycles / static_cast<double>(options.runs) / static_cast<double>(instructions),
+                seconds};
+    }
+
+    void print_csv(std::vector<result_t> const &results, char const *cycle_source)
+    {
+        std::printf("case,runs,median_seconds,p95_seconds,instructions,instructions_per_second,cycles_per_instruction,cycle_source\n");
+        for (auto const &result : results)
+        {
+            std::printf("%s,%zu,%.6f,%.6f,%" PRIu64 ",%.0f,", result.name.c_str(), result.runs, result.median_seconds,
+                        result.p95_seconds, result.instructions, result.instructions_per_second);
+            if (result.cycles_per_instruction >= 0) std::printf("%.3f", result.cycles_per_instruction);
+            std::printf(",%s\n", cycle_source);
+        }
+    }
+
+    void print_json(std::vector<result_t> const &results, char const *cycle_source)
+    {
+        std::printf("{\n  \"cycle_source\": \"%s\",\n  \"cases\": [", cycle_source);
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            auto const &result = results[i];
+            std::printf("%s\n    {\"case\": \"%s\", \"runs\": %zu, \"median_seconds\": %.6f, \"p95_seconds\": %.6f, "
+                        "\"instructions\": %" PRIu64 ", \"instructions_per_second\": %.0f, \"cycles_per_instruction\": ",
+                        i == 0 ? "" : ",", result.name.c_str(), result.runs, result.median_seconds, result.p95_seconds,
+                        result.instructions, result.instructions_per_second);
+            if (result.cycles_per_instruction < 0) std::printf("null}");
+            else std::printf("%.3f}", result.cycles_per_instruction);
+        }
+        std::printf("\n  ]\n}\n");
+    }
+
+    constexpr std::string_view baseline_magic = "b93-bench-baseline 1";
+
+    /* the magic line, then one line per case: name and the seconds of every timed run */
+    bool save_baseline(std::string const &path, std::vector<result_t> const &results)
+    {
+        std::ofstream file {path};
+        file << baseline_magic << "\n";
+        for (auto const &result : results)
+        {
+            file << result.name;
+            for (double seconds : result.seconds)
+            {
+                char text[32];
+                std::snprintf(text, sizeof(text), " %.9f", seconds);
+                file << text;
+            }
+            file << "\n";
+        }
+
+        return file.good();
+    }
+
+    std::vector<std::pair<std::string, std::vector<double>>> read_baseline(std::string const &path)
+    {
+        std::ifstream file {path};
+        std::string line;
+        if (!std::getline(file, line) || line != baseline_magic)
+        {
+            std::fprintf(stderr, "Error: %s is not a baseline, create one with make bench-baseline\n", path.c_str());
+            std::exit(EXIT_FAILURE);
+        }
+
+        std::vector<std::pair<std::string, std::vector<double>>> cases;
+        while (std::getline(file, line))
+        {
+            std::istringstream words {line};
+            std::pair<std::string, std::vector<double>> baseline_case;
+            if (!(words >> baseline_case.first)) continue;
+            for (double seconds; words >> seconds;) baseline_case.second.push_back(seconds);
+            cases.push_back(std::move(baseline_case));
+        }
+
+        return cases;
+    }
+
+    /* two sided 95% critical values of student's t for 1 to 30 degrees of freedom */
+    double t_critical(double degrees)
+    {
+        static constexpr std::array<double, 30> table {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                                       2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                                       2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+        if (degrees >= static_cast<double>(table.size())) return 1.96 + 2.4 / degrees;
+
+        return table[static_cast<std::size_t>(std::max(degrees, 1.0)) - 1];
+    }
+
+    struct delta_t
+    {
+        /* current over baseline minus one: the point estimate and the 95% confidence interval */
+        double estimate;
+        double low;
+        double high;
+    };
+
+    /* welch's t interval on the log of the run times, so the delta is a ratio and a few slow outliers
+     * weigh less */
+    delta_t compare_samples(std::vector<double> const &baseline, std::vector<double> const &current)
+    {
+        auto moments = [](std::vector<double> const &samples)
+        {
+            double mean = 0;
+            for (double seconds : samples) mean += std::log(seconds);
+            mean /= static_cast<double>(samples.size());
+
+            double variance = 0;
+            for (double seconds : samples) variance += (std::log(seconds) - mean) * (std::log(seconds) - mean);
+            variance /= static_cast<double>(std::max<std::size_t>(samples.size(), 2) - 1);
+            return std::pair{mean, variance / static_cast<double>(samples.size())};
+        };
+
+        auto const [baseline_mean, baseline_error] = moments(baseline);
+        auto const [current_mean, current_error] = moments(current);
+        double const difference = current_mean - baseline_mean;
+        double const error = std::sqrt(baseline_error + current_error);
+
+        /* welch-satterthwaite, with a floor for runs so steady that both variances are zero */
+        double const degrees = error > 0
+            ? (baseline_error + current_error) * (baseline_error + current_error) /
+              (baseline_error * baseline_error / static_cast<double>(std::max<std::size_t>(baseline.size(), 2) - 1) +
+               current_error * current_error / static_cast<double>(std::max<std::size_t>(current.size(), 2) - 1))
+            : 1;
+        double const margin = t_critical(degrees) * error;
+
+        return {std::exp(difference) - 1, std::exp(difference - margin) - 1, std::exp(difference + margin) - 1};
+    }
+
+    /* prints the delta table and returns whether any case regressed significantly */
+    bool check_baseline(std::string const &path, std::vector<result_t> const &results, double tolerance)
+    {
+        auto const baseline = read_baseline(path);
+        bool regressed = false;
+
+        std::printf("%-16s %12s %12s %9s %22s  %s\n", "case", "baseline_ms", "current_ms", "delta", "95% ci", "verdict");
+        for (auto const &result : results)
+        {
+            auto const found = std::find_if(baseline.begin(), baseline.end(), [&](auto const &baseline_case) { return baseline_case.first == result.name; });
+            if (found == baseline.end() || found->second.empty())
+            {
+                std::printf("%-16s %12s %12.3f %9s %22s  %s\n", result.name.c_str(), "-", result.median_seconds * 1e3, "-", "-", "new");
+                continue;
+            }
+
+            std::vector<double> sorted = found->second;
+            std::sort(sorted.begin(), sorted.end());
+            delta_t const delta = compare_samples(sorted, result.seconds);
+
+            /* significant when the interval excludes no change, a regression when also slower than the tolerance */
+            char const *verdict = "same";
+            if (delta.low > 0 && delta.estimate > tolerance)
+            {
+                verdict = "REGRESSION";
+                regressed = true;
+            }
+            else if (delta.low > 0)
+            {
+                verdict = "slower";
+            }
+            else if (delta.high < 0)
+            {
+                verdict = "faster";
+            }
+
+            char interval[48];
+            std::snprintf(interval, sizeof(interval), "[%+.1f%%, %+.1f%%]", delta.low * 100, delta.high * 100);
+            std::printf("%-16s %12.3f %12.3f %+8.1f%% %22s  %s\n", result.name.c_str(), percentile(sorted, 0.5) * 1e3,
+                        result.median_seconds * 1e3, delta.estimate * 100, interval, verdict);
+        }
+
+        for (auto const &[name, samples] : baseline)
+        {
+            bool const ran = std::any_of(results.begin(), results.end(), [&](result_t const &result) { return result.name == name; });
+            if (!ran) std::printf("%-16s %12.3f %12s %9s %22s  %s\n", name.c_str(), samples.empty() ? 0 : percentile(samples, 0.5) * 1e3, "-", "-", "-", "missing");
+        }
+
+        return regressed;
+    }
+
+    bool parse_count(char const *text, std::size_t &count)
+    {
+        char *end = nullptr;
+        unsigned long long const value = std::strtoull(text, &end, 10);
+        if (end == text || *end != '\0') return false;
+
+        count = static_cast<std::size_t>(value);
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    options_t options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view const arg = argv[i];
+        bool const has_value = i + 1 < argc;
+
+        if (arg == "--b93" && has_value) options.b93 = argv[++i];
+        else if (arg == "--corpus" && has_value) options.corpus = argv[++i];
+        else if (arg == "--runs" && has_value && parse_count(argv[i + 1], options.runs) && options.runs > 0) ++i;
+        else if (arg == "--warmup" && has_value && parse_count(argv[i + 1], options.warmup)) ++i;
+        else if (arg == "--format=csv") options.json = false;
+        else if (arg == "--format=json") options.json = true;
+        else if (arg == "--save-baseline" && has_value) options.save_baseline = argv[++i];
+        else if (arg == "--check" && has_value) options.check = argv[++i];
+        else if (arg == "--tolerance" && has_value)
+        {
+            options.tolerance = std::strtod(argv[++i], nullptr) / 100;
+        }
+        else
+        {
+            std::fprintf(stderr, "usage: bench [--b93 PATH] [--corpus FILE] [--runs N] [--warmup N] [--format=csv|json]\n"
+                                 "             [--save-baseline FILE] [--check FILE] [--tolerance PERCENT]\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    cycle_counter_t cycles;
+    std::vector<result_t> results;
+    for (auto const &bench_case : read_corpus(options.corpus))
+    {
+        results.push_back(run_case(bench_case, options, cycles));
+    }
+
+    if (!options.save_baseline.empty() && !save_baseline(options.save_baseline, results))
+    {
+        std::fprintf(stderr, "Error: could not write %s\n", options.save_baseline.c_str());
+        return EXIT_FAILURE;
+    }
+
+    if (!options.check.empty()) return check_baseline(options.check, results, options.tolerance) ? EXIT_FAILURE : EXIT_SUCCESS;
+
+    if (options.json) print_json(results, cycles.source());
+    else print_csv(results, cycles.source());
+}
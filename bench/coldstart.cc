@@ -0,0 +1,125 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <string>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* times b93 from exec to exit on programs that do next to nothing, where startup is all there is to
+ * measure. /bin/true is timed the same way as the floor any process pays here */
+
+extern char **environ;
+
+namespace
+{
+    struct options_t
+    {
+        std::string b93 = "./b93";
+        std::size_t runs = 500;
+        std::size_t warmup = 20;
+        double target_us = 300;
+    };
+
+    struct cold_case_t
+    {
+        std::string name;
+        std::vector<std::string> args;
+    };
+
+    /* seconds from posix_spawn to the child being reaped, stdin and stdout on /dev/null */
+    double time_spawn(std::vector<std::string> const &args)
+    {
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+        std::vector<char *> argv;
+        for (auto const &arg : args) argv.push_back(const_cast<char *>(arg.c_str()));
+        argv.push_back(nullptr);
+
+        auto const start = std::chrono::steady_clock::now();
+        pid_t pid = 0;
+        int status = 0;
+        bool const ok = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ) == 0 &&
+                        waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        posix_spawn_file_actions_destroy(&actions);
+
+        if (!ok)
+        {
+            std::fprintf(stderr, "Error: %s failed\n", args.front().c_str());
+            std::exit(EXIT_FAILURE);
+        }
+
+        return elapsed;
+    }
+
+    bool parse_count(char const *text, std::size_t &count)
+    {
+        char *end = nullptr;
+        unsigned long long const value = std::strtoull(text, &end, 10);
+        if (end == text || *end != '\0') return false;
+
+        count = static_cast<std::size_t>(value);
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    options_t options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view const arg = argv[i];
+        bool const has_value = i + 1 < argc;
+
+        if (arg == "--b93" && has_value) options.b93 = argv[++i];
+        else if (arg == "--runs" && has_value && parse_count(argv[i + 1], options.runs) && options.runs > 0) ++i;
+        else if (arg == "--warmup" && has_value && parse_count(argv[i + 1], options.warmup)) ++i;
+        else if (arg == "--target" && has_value) options.target_us = std::strtod(argv[++i], nullptr);
+        else
+        {
+            std::fprintf(stderr, "usage: coldstart [--b93 PATH] [--runs N] [--warmup N] [--target MICROSECONDS]\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* the trivial program lives in a temporary file for the length of the run */
+    std::string const trivial = "/tmp/b93-coldstart-" + std::to_string(getpid()) + ".b93";
+    if (std::FILE *const file = std::fopen(trivial.c_str(), "w"); file != nullptr)
+    {
+        std::fputs("@\n", file);
+        std::fclose(file);
+    }
+
+    std::vector<cold_case_t> const cases {
+        {"true", {"/bin/true"}},
+        {"trivial", {options.b93, trivial}},
+        {"soup", {options.b93, "--extensions=true", "tests/soup.b93"}},
+        {"soup-decoded", {options.b93, "--extensions=true", "--engine=decoded", "tests/soup.b93"}},
+    };
+
+    std::printf("case,runs,min_us,median_us,p95_us,target_us,verdict\n");
+    for (auto const &cold_case : cases)
+    {
+        for (std::size_t i = 0; i < options.warmup; ++i) time_spawn(cold_case.args);
+
+        std::vector<double> seconds;
+        for (std::size_t i = 0; i < options.runs; ++i) seconds.push_back(time_spawn(cold_case.args));
+        std::sort(seconds.begin(), seconds.end());
+
+        double const median = seconds[seconds.size() / 2] * 1e6;
+        double const p95 = seconds[std::min(seconds.size() - 1, seconds.size() * 95 / 100)] * 1e6;
+        std::printf("%s,%zu,%.1f,%.1f,%.1f,%.0f,%s\n", cold_case.name.c_str(), seconds.size(), seconds.front() * 1e6, median, p95,
+                    options.target_us, median <= options.target_us ? "ok" : "over");
+    }
+
+    std::remove(trivial.c_str());
+}
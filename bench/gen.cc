@@ -0,0 +1,461 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+#include <string>
+#include <array>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <optional>
+
+/* writes a befunge-93 program with controllable characteristics to stdout, for benchmarks that sweep
+ * one dimension at a time. every level of loop nesting takes three rows: the body running east, a
+ * helper row below and the lane the loop returns along, running west. the loop counters live on the
+ * stack. the innermost body drops into a block of lines below the loops
+ * that holds the work, where stack growth, output and p each run as a counted loop of their own and
+ * branches take two cells each, so every dimension scales without the others. a line that is full
+ * continues on the next one, and the last climbs back to the innermost body. p into the data writes
+ * the rows at the bottom */
+
+namespace
+{
+    constexpr std::size_t max_row_size = 25;
+    constexpr std::size_t max_col_size = 80;
+    constexpr std::size_t max_depth = 5;
+
+    /* the width of the loop count a p snippet takes modulo, so the snippet knows its own width */
+    constexpr std::size_t number_width = 5;
+
+    struct options_t
+    {
+        std::size_t depth = 2;
+        std::size_t iterations = 100;
+        std::size_t puts = 1;
+        double code_ratio = 0;
+        std::size_t stack_depth = 0;
+        bool nested_stack = false;
+        std::size_t branches = 1;
+        double branch_entropy = 0;
+        std::size_t output = 1;
+        double fill = 0;
+        std::uint32_t seed = 1;
+    };
+
+    using playfield_t = std::array<std::string, max_row_size>;
+
+    /* the shortest expression that pushes n (0 to 127) without control charecters */
+    std::string number(std::size_t n)
+    {
+        if (n <= 9) return std::string(1, static_cast<char>('0' + n));
+        if (n <= 18) return std::string{'9', static_cast<char>('0' + n - 9), '+'};
+        if (n <= 27) return std::string{'9', '9', '+', static_cast<char>('0' + n - 18), '+'};
+        if (n <= 31) return std::string{'7', '4', '*', static_cast<char>('0' + n - 28), '+'};
+        if (n == '"' || n == 127) return std::string{'"', static_cast<char>(n - 1), '"', '1', '+'};
+        return std::string{'"', static_cast<char>(n), '"'};
+    }
+
+    /* any count, built from multiples of 64 above 127 */
+    std::string number_expression(std::size_t n)
+    {
+        if (n <= 127) return number(n);
+
+        std::string result = number_expression(n / 64) + "88**";
+        if (n % 64 != 0) result += number(n % 64) + "+";
+        return result;
+    }
+
+    std::string padded_number(std::size_t n)
+    {
+        std::string result = number(n);
+        result.resize(number_width, ' ');
+        return result;
+    }
+
+    /* a snippet of a line or loop body. a loop runs its body count times and returns along the row
+     * below from the v at tail to the > at head, which are npos for straight snippets */
+    struct unit_t
+    {
+        std::string text;
+        std::size_t head = std::string::npos;
+        std::size_t tail = std::string::npos;
+        bool random_branch = false;
+    };
+
+    /* count > 0 runs of body with the counter on top of the stack, leaving the stack as it was */
+    unit_t counted_loop(std::size_t count, std::string_view body)
+    {
+        std::string const counter = number_expression(count);
+        unit_t unit {counter + ">" + std::string{body} + "1-:#v_$"};
+        unit.head = counter.size();
+        unit.tail = unit.text.size() - 3;
+        return unit;
+    }
+
+    /* count : or $, or a loop that pushes or pops count values when that is narrower */
+    unit_t stack_unit(std::size_t count, bool push)
+    {
+        unit_t const loop = counted_loop(count, push ? ":" : "\\$");
+        if (count == 0) return {};
+        if (count <= loop.text.size()) return {std::string(count, push ? ':' : '$')};
+        return loop;
+    }
+
+    class generator_t
+    {
+    public:
+        explicit generator_t(options_t const &options) : options{options}, random{options.seed}
+        {
+            for (auto &row : cells) row.assign(max_col_size, ' ');
+            for (auto &row : reserved) row.assign(max_col_size, false);
+        }
+
+        bool generate()
+        {
+            /* row 0 pushes the outermost counter and drops into the first loop */
+            std::string const init = number(options.iterations);
+            if (!put_text(0, 0, init)) return false;
+
+            std::size_t const head = init.size();
+            put(head, 0, 'v');
+            if (!level(0, head)) return false;
+
+            fill_unused();
+            return true;
+        }
+
+        void print() const
+        {
+            std::size_t rows = max_row_size;
+            while (rows > 0 && cells[rows - 1].find_last_not_of(' ') == std::string::npos) --rows;
+
+            for (std::size_t y = 0; y < rows; ++y)
+            {
+                std::size_t const end = cells[y].find_last_not_of(' ');
+                std::printf("%s\n", end == std::string::npos ? "" : cells[y].substr(0, end + 1).c_str());
+            }
+        }
+
+    private:
+        bool put(std::size_t x, std::size_t y, char ch)
+        {
+            if (x >= max_col_size || y >= max_row_size) return false;
+
+            cells[y][x] = ch;
+            reserved[y][x] = true;
+            return true;
+        }
+
+        bool put_text(std::size_t x, std::size_t y, std::string_view text)
+        {
+            for (char ch : text)
+            {
+                if (!put(x++, y, ch)) return false;
+            }
+            return true;
+        }
+
+        /* the path between two rows of a column stays blank */
+        void reserve_column(std::size_t x, std::size_t from, std::size_t to)
+        {
+            for (std::size_t y = from; y <= to; ++y) reserved[y][x] = true;
+        }
+
+        void reserve_row(std::size_t y, std::size_t from, std::size_t to)
+        {
+            for (std::size_t x = from; x <= to; ++x) reserved[y][x] = true;
+        }
+
+        /* lays a unit out at x of row y, a loop returning along row y + 1 */
+        bool put_unit(std::size_t x, std::size_t y, unit_t const &unit)
+        {
+            if (!put_text(x, y, unit.text)) return false;
+            if (unit.head != std::string::npos)
+            {
+                put(x + unit.head, y + 1, '^');
+                put(x + unit.tail, y + 1, '<');
+                reserve_row(y + 1, x + unit.head, x + unit.tail);
+            }
+            return true;
+        }
+
+        /* lays out loop k with its head at column head and returns whether it fit. the exit leaves
+         * column child_exit going north, or ends the program for the outermost loop */
+        bool level(std::size_t k, std::size_t head)
+        {
+            std::size_t const above = 3 * k, body = above + 1, lane = above + 3;
+            reserve_column(head, above, lane);
+            std::size_t x = head;
+            if (!put(x++, body, '>')) return false;
+
+            /* with the nested profile every level holds its share of the stack */
+            std::size_t const extra = options.nested_stack ? options.stack_depth / options.depth : 0;
+            unit_t const pushes = stack_unit(extra, true), pops = stack_unit(extra, false);
+            if (!put_unit(x, body, pushes)) return false;
+            x += pushes.text.size();
+
+            if (k + 1 < options.depth)
+            {
+                std::string const counter = number(options.iterations);
+                if (!put_text(x, body, counter)) return false;
+                x += counter.size();
+
+                std::size_t const entry = x;
+                if (!put(x, body, 'v')) return false;
+                reserve_column(entry, body, body + 3);
+                if (!level(k + 1, entry)) return false;
+
+                /* the child comes back up at its exit column */
+                x = child_exit;
+                reserve_column(x, body, child_exit_row);
+                if (!put(x++, body, '>')) return false;
+            }
+            else if (!work(x, body, pops.text.size()))
+            {
+                return false;
+            }
+
+            if (!put_unit(x, body, pops)) return false;
+            x += pops.text.size();
+            if (!put_text(x, body, "1-:v")) return false;
+            x += 3;
+
+            /* the lane back to the head, and the exit */
+            reserve_column(x, body, lane);
+            for (std::size_t lane_x = head; lane_x < x; ++lane_x) reserved[lane][lane_x] = true;
+            put(head, lane, '^');
+            put(x, lane, '_');
+            if (!put(x + 1, lane, '$')) return false;
+            if (!put(x + 2, lane, k == 0 ? '@' : '^')) return false;
+
+            child_exit = x + 2;
+            child_exit_row = lane;
+            return true;
+        }
+
+        /* the innermost body: stack growth, branches, output, p writes and the stack back down, laid
+         * out in lines below the loops. it leaves x where the body goes on, far enough left for the
+         * tails of every level, which take pop_width and six cells each */
+        bool work(std::size_t &x, std::size_t body, std::size_t pop_width)
+        {
+            std::size_t const tails = options.depth * (pop_width + 6);
+            if (tails >= max_col_size) return false;
+
+            std::size_t const back = max_col_size - 1 - tails, down = x;
+            std::size_t const entry = 3 * options.depth + 1;
+            if (back <= down + 1 || entry + 3 >= max_row_size) return false;
+
+            /* p into the data fills the bottom rows, writing the cell at column count of the last row
+             * below 80 and the cells from data_top on in order above that */
+            std::size_t const data_puts = options.puts - code_puts();
+            bool const one_row = data_puts < max_col_size;
+            std::size_t const data_rows = data_puts == 0 ? 0 : one_row ? 1 : (data_puts - 1) / max_col_size + 1;
+            if (data_rows > max_row_size - entry) return false;
+
+            std::size_t const data_top = max_row_size - data_rows;
+            for (std::size_t i = 1; i <= data_puts; ++i)
+            {
+                if (one_row) reserved[data_top][i] = true;
+                else reserved[data_top + (i - 1) / max_col_size][(i - 1) % max_col_size] = true;
+            }
+
+            /* down to the entry lane, which runs west to the first line */
+            put(down, body, 'v');
+            reserve_column(down, body + 1, entry - 1);
+            put(down, entry, '<');
+            reserve_row(entry, 1, down - 1);
+            put(0, entry, 'v');
+
+            std::size_t line = 0, at = 1;
+            auto row_of = [&](std::size_t index) { return entry + 2 + 4 * index; };
+            reserve_column(0, entry + 1, entry + 1);
+            put(0, row_of(0), '>');
+            if (row_of(0) + 1 >= data_top) return false;
+
+            auto place = [&](auto const &make) -> bool
+            {
+                unit_t unit = make(at, row_of(line));
+                if (at + unit.text.size() >= back)
+                {
+                    /* the line goes down to its lane, which runs west to the next line */
+                    std::size_t const row = row_of(line), lane = row + 2;
+                    if (row_of(line + 1) + 1 >= data_top) return false;
+
+                    put(at, row, 'v');
+                    reserve_column(at, row + 1, row + 1);
+                    put(at, lane, '<');
+                    reserve_row(lane, 1, at - 1);
+                    put(0, lane, 'v');
+                    reserve_column(0, lane + 1, lane + 1);
+                    put(0, row_of(++line), '>');
+                    at = 1;
+
+                    unit = make(at, row_of(line));
+                    if (at + unit.text.size() >= back) return false;
+                }
+
+                if (!put_unit(at, row_of(line), unit)) return false;
+                if (unit.random_branch)
+                {
+                    put(at + 1, row_of(line) - 1, 'v');
+                    put(at + 1, row_of(line) + 1, '^');
+                }
+                at += unit.text.size();
+                return true;
+            };
+
+            std::size_t const flat = options.nested_stack ? 0 : options.stack_depth;
+            if (flat > 0 && !place([&](std::size_t, std::size_t) { return counted_loop(flat, ":"); })) return false;
+
+            /* a ? bounces back off the > before it and the v and ^ around it until it draws east, so it
+             * costs a random number of draws. the alternative 0_ always leaves east */
+            std::bernoulli_distribution random_branch {options.branch_entropy};
+            for (std::size_t i = 0; i < options.branches; ++i)
+            {
+                bool const random_choice = random_branch(random);
+                if (!place([&](std::size_t, std::size_t) { return unit_t {random_choice ? ">?" : "0_", std::string::npos, std::string::npos, random_choice}; }))
+                {
+                    return false;
+                }
+            }
+
+            std::uniform_int_distribution<int> letter {'a', 'z'};
+            std::string const printed {'"', static_cast<char>(letter(random)), '"', ','};
+            if (options.output > 0 && !place([&](std::size_t, std::size_t) { return counted_loop(options.output, printed); })) return false;
+
+            /* p into the code puts a blank back into the lane its own loop returns along, so the cells it
+             * writes are on the path. the counter picks the cell, modulo the lane when it is shorter */
+            std::size_t const code = options.puts - data_puts;
+            if (code > 0 && !place([&](std::size_t at_x, std::size_t row) { return code_put_loop(code, at_x, row + 1); })) return false;
+
+            /* p into the data writes a letter to the cell the counter names */
+            std::string const written {'"', static_cast<char>(letter(random)), '"'};
+            std::string const data_body = one_row ? ":" + written + "\\" + number(data_top) + "p"
+                                                  : ":1-" + written + "\\:\"P\"%\\\"P\"/" + number(data_top) + "+p";
+            if (data_puts > 0 && !place([&](std::size_t, std::size_t) { return counted_loop(data_puts, data_body); })) return false;
+
+            if (flat > 0 && !place([&](std::size_t, std::size_t) { return counted_loop(flat, "\\$"); })) return false;
+
+            /* the last line climbs back to the body */
+            reserve_row(row_of(line), at, back - 1);
+            put(back, row_of(line), '^');
+            reserve_column(back, body + 1, row_of(line) - 1);
+            put(back, body, '>');
+            x = back + 1;
+            return true;
+        }
+
+        /* how many of the p per iteration write into the code */
+        std::size_t code_puts()
+        {
+            if (!code_count)
+            {
+                std::bernoulli_distribution into_code {options.code_ratio};
+                code_count = 0;
+                for (std::size_t i = 0; i < options.puts; ++i) *code_count += into_code(random);
+            }
+            return *code_count;
+        }
+
+        /* a loop at column x whose p writes blanks into the lane below it on row lane */
+        unit_t code_put_loop(std::size_t count, std::size_t x, std::size_t lane)
+        {
+            std::size_t const first = x + number_expression(count).size() + 1;
+
+            /* the loop counts down from count, so lane cells first to first + count - 1 */
+            unit_t unit = counted_loop(count, ":48*\\" + number(first - 1) + "+" + number(lane) + "p");
+            if (count + 1 < unit.tail - unit.head) return unit;
+
+            std::string const wrapped = number(first) + "+" + number(lane) + "p";
+            unit = counted_loop(count, ":48*\\" + std::string(number_width, ' ') + "%" + wrapped);
+            std::size_t const width = unit.tail - unit.head - 1;
+            return counted_loop(count, ":48*\\" + padded_number(width) + "%" + wrapped);
+        }
+
+        /* scatters opcodes over cells no path crosses */
+        void fill_unused()
+        {
+            static constexpr std::string_view opcodes = "+-*/%!`><^v?_|:\\$.,#gp&~0123456789";
+            std::bernoulli_distribution filled {options.fill};
+            std::uniform_int_distribution<std::size_t> opcode {0, opcodes.size() - 1};
+
+            for (std::size_t y = 0; y < max_row_size; ++y)
+            {
+                for (std::size_t x = 0; x < max_col_size; ++x)
+                {
+                    if (!reserved[y][x] && filled(random)) cells[y][x] = opcodes[opcode(random)];
+                }
+            }
+        }
+
+        options_t const &options;
+        std::mt19937 random;
+        playfield_t cells;
+        std::array<std::vector<bool>, max_row_size> reserved;
+        std::size_t child_exit = 0;
+        std::size_t child_exit_row = 0;
+        std::optional<std::size_t> code_count;
+    };
+
+    bool parse_count(char const *text, std::size_t &count)
+    {
+        char *end = nullptr;
+        unsigned long long const value = std::strtoull(text, &end, 10);
+        if (end == text || *end != '\0') return false;
+
+        count = static_cast<std::size_t>(value);
+        return true;
+    }
+
+    bool parse_fraction(char const *text, double &fraction)
+    {
+        char *end = nullptr;
+        fraction = std::strtod(text, &end);
+        return end != text && *end == '\0' && fraction >= 0 && fraction <= 1;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    options_t options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view const arg = argv[i];
+        char const *value = i + 1 < argc ? argv[i + 1] : "";
+        std::size_t seed = 0;
+        bool ok = i + 1 < argc;
+
+        if (arg == "--loop-depth") ok = ok && parse_count(value, options.depth) && options.depth >= 1 && options.depth <= max_depth;
+        else if (arg == "--iterations") ok = ok && parse_count(value, options.iterations) && options.iterations >= 1 && options.iterations <= 127;
+        else if (arg == "--puts") ok = ok && parse_count(value, options.puts);
+        else if (arg == "--code-ratio") ok = ok && parse_fraction(value, options.code_ratio);
+        else if (arg == "--stack-depth") ok = ok && parse_count(value, options.stack_depth);
+        else if (arg == "--stack-profile") ok = ok && ((options.nested_stack = std::string_view{value} == "nested") || std::string_view{value} == "flat");
+        else if (arg == "--branches") ok = ok && parse_count(value, options.branches);
+        else if (arg == "--branch-entropy") ok = ok && parse_fraction(value, options.branch_entropy);
+        else if (arg == "--output") ok = ok && parse_count(value, options.output);
+        else if (arg == "--fill") ok = ok && parse_fraction(value, options.fill);
+        else if (arg == "--seed") ok = ok && parse_count(value, seed) && ((options.seed = static_cast<std::uint32_t>(seed)), true);
+        else ok = false;
+
+        if (!ok)
+        {
+            std::fprintf(stderr,
+                         "usage: gen [--loop-depth 1-%zu] [--iterations 1-127] [--puts N] [--code-ratio 0-1]\n"
+                         "           [--stack-depth N] [--stack-profile flat|nested] [--branches N]\n"
+                         "           [--branch-entropy 0-1] [--output N] [--fill 0-1] [--seed N]\n", max_depth);
+            return EXIT_FAILURE;
+        }
+        ++i;
+    }
+
+    generator_t generator {options};
+    if (!generator.generate())
+    {
+        std::fprintf(stderr, "Error: the program does not fit in %zux%zu, use smaller counts or less nesting\n",
+                     max_col_size, max_row_size);
+        return EXIT_FAILURE;
+    }
+
+    generator.print();
+}
@@ -0,0 +1,237 @@
+#include <cstdio>
+#include <cinttypes>
+#include <cstdlib>
+#include <string_view>
+#include <string>
+#include <array>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <unistd.h>
+
+#include "spawn.hh"
+
+/* times tight loops around a single opcode on every engine b93 offers and reports the cost per
+ * executed instruction once the loop skeleton is subtracted. the loop returns along a lane of blank
+ * cells as wide as its body, so the cost of a blank cell is measured with a body of blanks and
+ * taken off as well */
+
+namespace
+{
+    constexpr std::size_t max_col_size = 80;
+    constexpr std::size_t max_row_size = 25;
+
+    /* a stack neutral snippet that repeats in the loop body. the stack holds a spare value under the
+     * loop counter, so snippets may swap. ext_snippet replaces snippet when extensions are on, for
+     * opcodes whose meaning depends on them */
+    struct micro_case_t
+    {
+        char const *name;
+        char const *snippet;
+        char const *ext_snippet;
+    };
+
+    constexpr std::array<micro_case_t, 11> cases {{
+        {"+", "11+$", nullptr},
+        {":", ":$", nullptr},
+        {"\\", "\\\\", nullptr},
+        {"g", "00g$", nullptr},
+        {"p", "0\"O\"83*p", nullptr},
+        {"\"", "\"aaaa\"$$$$", nullptr},
+        {"#", "# ", nullptr},
+        {"?", ">?", nullptr},
+        {".", "1.", nullptr},
+        {"a", "a", "a$"},
+        {"'", "' ", "' $"},
+    }};
+
+    constexpr std::size_t iterations = 200000;
+
+    struct program_t
+    {
+        std::string source;
+        std::size_t repeats;
+        std::size_t width;
+    };
+
+    /* 0, then the loop counter (iterations) under which the body runs, then the body and the counting
+     * tail. the loop returns along row 2, a ? bounces back off a ^ in row 1 and a v in row 24 */
+    program_t synthesize(std::string_view snippet, bool empty_body)
+    {
+        std::string const prefix = "0\"d\":*45**>";
+        std::string const suffix = "1-:v";
+        std::size_t const repeats = empty_body ? 0 : std::min<std::size_t>(32, (max_col_size - prefix.size() - suffix.size() - 1) / snippet.size());
+
+        std::array<std::string, max_row_size> rows;
+        rows[0] = prefix;
+        for (std::size_t i = 0; i < repeats; ++i) rows[0] += snippet;
+        rows[0] += suffix;
+
+        rows[1].assign(rows[0].size(), ' ');
+        rows[24].assign(rows[0].size(), ' ');
+        for (std::size_t x = prefix.size(); x + suffix.size() < rows[0].size(); ++x)
+        {
+            if (rows[0][x] == '?')
+            {
+                rows[1][x] = '^';
+                rows[24][x] = 'v';
+            }
+        }
+
+        rows[2].assign(rows[0].size() + 1, ' ');
+        rows[2][prefix.size() - 1] = '^';
+        rows[2][rows[0].size() - 1] = '_';
+        rows[2][rows[0].size()] = '@';
+
+        program_t program {{}, repeats, repeats * snippet.size()};
+        for (auto const &row : rows) program.source += row + "\n";
+        return program;
+    }
+
+    struct measurement_t
+    {
+        std::uint64_t instructions;
+        double seconds;
+    };
+
+    /* exact instructions from one seeded counting run, so every engine draws the same ? outcomes, then the
+     * fastest of the timed runs replaying it */
+    measurement_t measure(std::string const &b93, std::string const &program, std::string const &engine,
+                          bool extensions, std::size_t runs)
+    {
+        std::string const base = "/tmp/b93-micro-" + std::to_string(getpid());
+        std::string const path = base + ".b93", log = base + ".log";
+        std::ofstream{path} << program;
+
+        std::string const mode = extensions ? "--extensions=true" : "--extensions=false";
+        std::string report;
+        if (!bench::spawn({b93, "--engine=" + engine, mode, "--seed=1", "--stats=json", "--record", log, path}, true, report))
+        {
+            std::fprintf(stderr, "Error: counting run failed\n%s", report.c_str());
+            std::exit(EXIT_FAILURE);
+        }
+
+        double best = 0;
+        for (std::size_t i = 0; i < runs; ++i)
+        {
+            std::string unused;
+            auto const start = std::chrono::steady_clock::now();
+            bench::spawn({b93, "--engine=" + engine, mode, "--replay", log, path}, false, unused);
+            double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = i == 0 ? elapsed : std::min(best, elapsed);
+        }
+
+        std::remove(path.c_str());
+        std::remove(log.c_str());
+        return {bench::stats_instructions(report), best};
+    }
+
+    bool parse_count(char const *text, std::size_t &count)
+    {
+        char *end = nullptr;
+        unsigned long long const value = std::strtoull(text, &end, 10);
+        if (end == text || *end != '\0') return false;
+
+        count = static_cast<std::size_t>(value);
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string b93 = "./b93";
+    std::size_t runs = 5;
+
+    /* --check runs every case once and compares the instruction counts of the engines instead of timing */
+    bool check = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view const arg = argv[i];
+        if (arg == "--b93" && i + 1 < argc) b93 = argv[++i];
+        else if (arg == "--runs" && i + 1 < argc && parse_count(argv[i + 1], runs) && runs > 0) ++i;
+        else if (arg == "--check") check = true;
+        else
+        {
+            std::fprintf(stderr, "usage: microbench [--b93 PATH] [--runs N] [--check]\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<std::string> const engines = bench::list_engines(b93);
+    if (engines.empty())
+    {
+        std::fprintf(stderr, "Error: %s --list-engines printed no engines\n", b93.c_str());
+        return EXIT_FAILURE;
+    }
+
+    if (check)
+    {
+        /* the counts of the first engine, by extension mode and case */
+        std::vector<std::uint64_t> expected;
+        bool agree = true;
+        for (auto const &engine : engines)
+        {
+            std::size_t index = 0;
+            for (bool const extensions : {false, true})
+            {
+                for (auto const &micro_case : cases)
+                {
+                    if (extensions && !micro_case.ext_snippet) continue;
+
+                    std::string_view const snippet = extensions ? micro_case.ext_snippet : micro_case.snippet;
+                    std::uint64_t const instructions = measure(b93, synthesize(snippet, false).source, engine, extensions, 1).instructions;
+                    if (&engine == &engines.front()) expected.push_back(instructions);
+                    else if (instructions != expected[index])
+                    {
+                        std::fprintf(stderr, "Error: %s counts %" PRIu64 " instructions for \"%.*s\" with extensions=%s, %s counts %" PRIu64 "\n",
+                                     engine.c_str(), instructions, static_cast<int>(snippet.size()), snippet.data(),
+                                     extensions ? "true" : "false", engines.front().c_str(), expected[index]);
+                        agree = false;
+                    }
+                    ++index;
+                }
+            }
+        }
+
+        if (!agree) return EXIT_FAILURE;
+        std::printf("every case runs on %zu engines with the same instruction counts\n", engines.size());
+        return EXIT_SUCCESS;
+    }
+
+    std::printf("engine,extensions,opcode,snippet,instructions_per_snippet,ns_per_instruction,ns_per_snippet\n");
+    for (auto const &engine : engines)
+    {
+        for (bool const extensions : {false, true})
+        {
+            measurement_t const skeleton = measure(b93, synthesize("", true).source, engine, extensions, runs);
+            program_t const blank_program = synthesize(" ", false);
+            measurement_t const blank = measure(b93, blank_program.source, engine, extensions, runs);
+            double const blank_seconds = (blank.seconds - skeleton.seconds) / static_cast<double>(blank.instructions - skeleton.instructions);
+            for (auto const &micro_case : cases)
+            {
+                /* opcodes that mean the same either way only run once */
+                if (extensions && !micro_case.ext_snippet) continue;
+
+                std::string_view const snippet = extensions ? micro_case.ext_snippet : micro_case.snippet;
+                program_t const program = synthesize(snippet, false);
+                measurement_t const result = measure(b93, program.source, engine, extensions, runs);
+
+                std::size_t const snippets = iterations * program.repeats;
+                std::size_t const lane = iterations * program.width;
+                double const instructions = static_cast<double>(result.instructions - skeleton.instructions - lane);
+                double const nanoseconds = (result.seconds - skeleton.seconds - static_cast<double>(lane) * blank_seconds) * 1e9;
+
+                std::printf("%s,%s,\"%s\",\"", engine.c_str(), extensions ? "true" : "false",
+                            micro_case.name[0] == '"' ? "\"\"" : micro_case.name);
+                for (char ch : snippet)
+                {
+                    if (ch == '"') std::putchar('"');
+                    std::putchar(ch);
+                }
+                std::printf("\",%.2f,%.3f,%.3f\n", instructions / static_cast<double>(snippets),
+                            nanoseconds / instructions, nanoseconds / static_cast<double>(snippets));
+            }
+        }
+    }
+}
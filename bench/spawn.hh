@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <array>
+#include <vector>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace bench
+{
+    /* runs a program with stdin and stdout on /dev/null, collects its stderr when capture is set and
+     * returns whether it exited with status 0 */
+    inline bool spawn(std::vector<std::string> const &args, bool capture, std::string &errors)
+    {
+        int pipe_fds[2] = {-1, -1};
+        if (capture && pipe(pipe_fds) != 0) return false;
+
+        pid_t const pid = fork();
+        if (pid == 0)
+        {
+            int const null = open("/dev/null", O_RDWR);
+            dup2(null, STDIN_FILENO);
+            dup2(null, STDOUT_FILENO);
+            if (capture) dup2(pipe_fds[1], STDERR_FILENO);
+
+            std::vector<char *> argv;
+            for (auto const &arg : args) argv.push_back(const_cast<char *>(arg.c_str()));
+            argv.push_back(nullptr);
+            execv(argv[0], argv.data());
+            _exit(127);
+        }
+
+        if (capture)
+        {
+            close(pipe_fds[1]);
+            std::array<char, 4096> buffer;
+            for (ssize_t size; (size = read(pipe_fds[0], buffer.data(), buffer.size())) > 0;) errors.append(buffer.data(), size);
+            close(pipe_fds[0]);
+        }
+
+        int status = 0;
+        return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    /* the "instructions" count from a b93 --stats=json report, 0 when there is none */
+    inline std::uint64_t stats_instructions(std::string const &report)
+    {
+        std::size_t const found = report.find("\"instructions\": ");
+        return found == std::string::npos ? 0 : std::strtoull(report.c_str() + found + 16, nullptr, 10);
+    }
+
+    /* the engine names b93 --list-engines prints */
+    inline std::vector<std::string> list_engines(std::string const &b93)
+    {
+        std::vector<std::string> engines;
+        int pipe_fds[2];
+        if (pipe(pipe_fds) != 0) return engines;
+
+        pid_t const pid = fork();
+        if (pid == 0)
+        {
+            dup2(pipe_fds[1], STDOUT_FILENO);
+            execl(b93.c_str(), b93.c_str(), "--list-engines", static_cast<char *>(nullptr));
+            _exit(127);
+        }
+
+        close(pipe_fds[1]);
+        std::string output;
+        std::array<char, 4096> buffer;
+        for (ssize_t size; (size = read(pipe_fds[0], buffer.data(), buffer.size())) > 0;) output.append(buffer.data(), size);
+        close(pipe_fds[0]);
+        waitpid(pid, nullptr, 0);
+
+        for (std::size_t start = 0, end; (end = output.find('\n', start)) != std::string::npos; start = end + 1)
+        {
+            if (end > start) engines.push_back(output.substr(start, end - start));
+        }
+
+        return engines;
+    }
+}
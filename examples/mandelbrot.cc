@@ -0,0 +1,20 @@
+#include <cstdio>
+
+#include "../b93.hh"
+
+/* tests/mandelbrot.b93 computed by the compiler, the binary only writes the result. make
+ * examples/mandelbrot wraps the program in a raw string literal as examples/mandelbrot.inc */
+struct mandelbrot
+{
+    static constexpr std::string_view source =
+#include "mandelbrot.inc"
+    ;
+};
+
+/* about 22 million befunge instructions */
+constexpr auto output = b93::bake<mandelbrot, std::uint64_t{1} << 25>();
+
+int main()
+{
+    std::fwrite(output.data(), 1, output.size(), stdout);
+}
@@ -0,0 +1,279 @@
+/* differential fuzzing: runs a program on every engine and on the constexpr interpreter of b93.hh with
+ * a step budget and fails when any of them disagrees with switch on the output, the final stack, the
+ * final playfield, the instruction count or whether it finished. builds as a libfuzzer target with -DB93_LIBFUZZER, and otherwise as a
+ * standalone driver that checks the given files or generates random programs and minimizes the
+ * mismatches it finds */
+
+/* the engines are internal to b93.cc, so it is compiled into this file with its main renamed */
+#define main b93_main
+#include "../b93.cc"
+#undef main
+
+namespace fuzz
+{
+    constexpr std::uint64_t default_budget = 100000;
+
+    struct outcome_t
+    {
+        bool completed;
+        std::uint64_t instructions;
+        std::string output;
+        final_state_t state;
+    };
+
+    /* stdout is pointed at a temporary file once, every run truncates it */
+    int capture_output()
+    {
+        static int const fd = []
+        {
+            std::FILE *const file = std::tmpfile();
+            if (file == nullptr || std::freopen("/dev/null", "r", stdin) == nullptr)
+            {
+                std::fprintf(stderr, "Error: could not redirect stdio\n");
+                std::exit(EXIT_FAILURE);
+            }
+
+            std::fflush(stdout);
+            dup2(fileno(file), STDOUT_FILENO);
+            return fileno(file);
+        }();
+
+        return fd;
+    }
+
+    /* ? draws from the same seed on every engine, and ~ and & read end of input */
+    outcome_t execute(std::size_t engine, grid_t const &grid, bool extensions, std::uint64_t budget)
+    {
+        int const fd = capture_output();
+        std::fflush(stdout);
+        if (ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0) std::exit(EXIT_FAILURE);
+
+        outcome_t outcome = {};
+        options_t options;
+        options.extensions = extensions;
+        options.max_steps = budget;
+        options.seeded = true;
+        options.final_state = &outcome.state;
+
+        std::unique_ptr<stats_t> const stats = std::make_unique<stats_t>();
+        event_log_t events;
+        outcome.completed = run_engine(engine, hook_count, grid, options, *stats, events);
+        std::fflush(stdout);
+
+        outcome.instructions = stats->instructions;
+        outcome.output = read_all(fd);
+        return outcome;
+    }
+
+    /* b93.hh stops where the runtime engines would read input or draw a ? outcome, and at the end of
+     * its fixed buffers, so only the runs it completes or cuts at the budget can be compared */
+    constexpr std::size_t constexpr_stack_capacity = std::size_t{1} << 17;
+    constexpr std::size_t constexpr_output_capacity = std::size_t{1} << 17;
+
+    std::string constexpr_mismatch(grid_t const &grid, bool extensions, std::uint64_t budget, outcome_t const &reference)
+    {
+        auto const machine = b93::run<constexpr_stack_capacity, constexpr_output_capacity>(grid.data, extensions, budget);
+        if (machine.status != b93::status_t::finished && machine.status != b93::status_t::out_of_steps) return {};
+
+        if ((machine.status == b93::status_t::finished) != reference.completed) return "constexpr: finished where switch did not, or the other way round";
+        if (machine.steps != reference.instructions)
+        {
+            return "constexpr: " + std::to_string(machine.steps) + " instructions, switch " + std::to_string(reference.instructions);
+        }
+        if (std::string_view{machine.output.data(), machine.written} != reference.output) return "constexpr: output differs";
+        if (!std::equal(machine.stack.begin(), machine.stack.begin() + machine.depth, reference.state.stack.begin(), reference.state.stack.end()))
+        {
+            return "constexpr: final stack differs";
+        }
+        if (machine.grid != reference.state.data)
+        {
+            auto const cell = std::mismatch(machine.grid.begin(), machine.grid.end(), reference.state.data.begin()).first - machine.grid.begin();
+            return "constexpr: playfield differs at " + std::to_string(cell % grid.cols) + "," + std::to_string(cell / grid.cols);
+        }
+
+        return {};
+    }
+
+    /* what the first engine to disagree with switch got wrong, empty when they all agree */
+    std::string mismatch(grid_t const &grid, bool extensions, std::uint64_t budget)
+    {
+        outcome_t const reference = execute(engine_switch, grid, extensions, budget);
+        for (std::size_t engine = engine_switch + 1; engine < tier_names.size(); ++engine)
+        {
+            outcome_t const outcome = execute(engine, grid, extensions, budget);
+            std::string const engine_name = tier_names[engine];
+
+            if (outcome.completed != reference.completed) return engine_name + ": finished where switch did not, or the other way round";
+            if (outcome.instructions != reference.instructions)
+            {
+                return engine_name + ": " + std::to_string(outcome.instructions) + " instructions, switch " + std::to_string(reference.instructions);
+            }
+            if (outcome.output != reference.output) return engine_name + ": output differs";
+            if (outcome.state.stack != reference.state.stack) return engine_name + ": final stack differs";
+            if (outcome.state.data != reference.state.data)
+            {
+                auto const cell = std::mismatch(outcome.state.data.begin(), outcome.state.data.end(), reference.state.data.begin()).first -
+                                  outcome.state.data.begin();
+                return engine_name + ": playfield differs at " + std::to_string(cell % grid.cols) + "," + std::to_string(cell / grid.cols);
+            }
+        }
+
+        return constexpr_mismatch(grid, extensions, budget, reference);
+    }
+
+    std::string program_text(grid_t const &grid)
+    {
+        std::string text;
+        for (std::size_t y = 0; y < grid.rows; ++y)
+        {
+            std::string line {grid.data.data() + y * grid.cols, max_col_size};
+            std::replace(line.begin(), line.end(), '\0', ' ');
+            line.erase(line.find_last_not_of(' ') + 1);
+            text += line + "\n";
+        }
+
+        text.erase(text.find_last_not_of('\n') + 1);
+        return text + "\n";
+    }
+}
+
+/* the first byte selects the extension mode, the rest is the program */
+extern "C" int LLVMFuzzerTestOneInput(std::uint8_t const *data, std::size_t size)
+{
+    if (size == 0) return 0;
+
+    bool const extensions = (data[0] & 1) != 0;
+    grid_t const grid = parse_grid(reinterpret_cast<char const *>(data + 1), size - 1);
+    std::string const difference = fuzz::mismatch(grid, extensions, fuzz::default_budget);
+    if (!difference.empty())
+    {
+        std::fprintf(stderr, "%s\n%s", difference.c_str(), fuzz::program_text(grid).c_str());
+        std::abort();
+    }
+
+    return 0;
+}
+
+#ifndef B93_LIBFUZZER
+namespace fuzz
+{
+    /* opcode soup weighted toward the edge cases engines tend to get wrong: pops from an empty stack,
+     * \ with fewer than two values, g and p out of bounds, # at the edges and wrapping */
+    grid_t generate(std::mt19937 &random)
+    {
+        static constexpr std::string_view common = "+-*/%!`:\\$.,gp#_|?\"&~@0123456789abcdef'";
+        static constexpr std::string_view arrows = "><^v";
+        grid_t grid = {};
+
+        std::uniform_int_distribution<std::size_t> size {1, max_row_size}, width {1, max_col_size};
+        std::size_t const rows = size(random), cols = width(random);
+        std::uniform_real_distribution<double> chance {0, 1};
+        double const density = chance(random);
+
+        for (std::size_t y = 0; y < rows; ++y)
+        {
+            for (std::size_t x = 0; x < cols; ++x)
+            {
+                double const roll = chance(random);
+                char ch = ' ';
+                bool const edge = x == 0 || x == cols - 1 || y == 0 || y == rows - 1;
+                if (edge && roll < 0.1) ch = '#';
+                else if (roll < density * 0.2) ch = arrows[random() % arrows.size()];
+                else if (roll < density) ch = common[random() % common.size()];
+                grid.data[y * grid.cols + x] = ch;
+            }
+        }
+
+        return grid;
+    }
+
+    /* blanks every cell it can while the mismatch stays, until no cell can go */
+    grid_t minimize(grid_t grid, bool extensions, std::uint64_t budget)
+    {
+        for (bool shrunk = true; shrunk;)
+        {
+            shrunk = false;
+            for (std::size_t cell = 0; cell < grid_cells; ++cell)
+            {
+                if (grid.data[cell] == ' ' || grid.data[cell] == '\0') continue;
+
+                grid_t candidate = grid;
+                candidate.data[cell] = ' ';
+                if (!mismatch(candidate, extensions, budget).empty())
+                {
+                    grid = candidate;
+                    shrunk = true;
+                }
+            }
+        }
+
+        return grid;
+    }
+
+    bool report(grid_t const &grid, bool extensions, std::uint64_t budget, std::string const &name)
+    {
+        grid_t const minimal = minimize(grid, extensions, budget);
+        std::string const difference = mismatch(minimal, extensions, budget);
+        std::string const text = program_text(minimal);
+        std::string const path = "fuzz-" + name + ".b93";
+        std::ofstream{path} << text;
+
+        std::fprintf(stderr, "mismatch (extensions %s): %s\nminimized to %s:\n%s", extensions ? "true" : "false",
+                     difference.c_str(), path.c_str(), text.c_str());
+        return false;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t runs = 10000;
+    std::uint64_t budget = fuzz::default_budget;
+    std::uint32_t seed = static_cast<std::uint32_t>(std::time(nullptr));
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view const arg = argv[i];
+        bool const has_value = i + 1 < argc;
+
+        if (arg == "--runs" && has_value) runs = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--budget" && has_value) budget = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--seed" && has_value) seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg.substr(0, 2) != "--") files.emplace_back(arg);
+        else
+        {
+            std::fprintf(stderr, "usage: differential [--runs N] [--seed N] [--budget STEPS] [FILE...]\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    bool agreed = true;
+
+    /* files are checked in both extension modes */
+    for (auto const &file : files)
+    {
+        grid_t const grid = readfile(file);
+        for (bool const extensions : {false, true})
+        {
+            std::string const difference = fuzz::mismatch(grid, extensions, budget);
+            if (!difference.empty()) agreed &= fuzz::report(grid, extensions, budget, "file-" + std::to_string(&file - files.data()));
+        }
+    }
+
+    if (files.empty())
+    {
+        std::fprintf(stderr, "seed %" PRIu32 ", %zu programs, %" PRIu64 " steps each\n", seed, runs, budget);
+        std::mt19937 random {seed};
+        for (std::size_t run = 0; run < runs; ++run)
+        {
+            grid_t const grid = fuzz::generate(random);
+            bool const extensions = random() % 2 != 0;
+            std::string const difference = fuzz::mismatch(grid, extensions, budget);
+            if (!difference.empty()) agreed &= fuzz::report(grid, extensions, budget, std::to_string(seed) + "-" + std::to_string(run));
+        }
+    }
+
+    if (agreed) std::fprintf(stderr, "all engines agree\n");
+    return agreed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+#endif